@@ -0,0 +1,93 @@
+#include <iostream>
+#include <vector>
+
+#include "decoder.h"
+#include "harness.h"
+#include "synthetic.h"
+
+// The decoder as a whole, on a synthetic signal it should be
+// able to decode every minute of.
+
+namespace
+{
+
+// Long enough to lock and decode a couple of minutes.
+const int DECODE_SECONDS = 4 * 60;
+
+const int MACRO_SECONDS = 60 * 60;
+
+// The two halves of WwvDecoder::process(), which the pipeline
+// runs on separate threads.
+void benchDetect(BenchState& state)
+{
+    std::vector<int16_t> audio = syntheticAudio(SYNTHETIC_START, DECODE_SECONDS);
+    std::ostream discard(nullptr);
+    WwvDecoder decoder(DecoderOptions(), discard, [](const DecodedMinute&) {});
+    CarrierBlock block;
+
+    state.set_samples_per_iteration(CarrierBlock::MAX_SAMPLES);
+    size_t pos = 0;
+    while (state.keep_running())
+    {
+        decoder.detect(&audio[pos], CarrierBlock::MAX_SAMPLES, block);
+        doNotOptimize(block.count);
+        pos += CarrierBlock::MAX_SAMPLES;
+        if (pos + CarrierBlock::MAX_SAMPLES > audio.size()) pos = 0;
+    }
+}
+BENCHMARK("WwvDecoder::detect", benchDetect);
+
+// The state machine and everything else that runs per carrier
+// sample, on the whole signal each time.
+void benchDecode(BenchState& state)
+{
+    std::vector<int16_t> audio = syntheticAudio(SYNTHETIC_START, DECODE_SECONDS);
+    std::ostream discard(nullptr);
+
+    std::vector<CarrierBlock> blocks(audio.size() / CarrierBlock::MAX_SAMPLES);
+    WwvDecoder detector(DecoderOptions(), discard, [](const DecodedMinute&) {});
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        detector.detect(&audio[i * CarrierBlock::MAX_SAMPLES], CarrierBlock::MAX_SAMPLES, blocks[i]);
+    }
+
+    state.set_samples_per_iteration(blocks.size() * CarrierBlock::MAX_SAMPLES);
+    int numMinutes = 0;
+    while (state.keep_running())
+    {
+        state.pause_timing();
+        WwvDecoder decoder(DecoderOptions(), discard, [&numMinutes](const DecodedMinute&) { numMinutes++; });
+        state.resume_timing();
+
+        for (const CarrierBlock& block : blocks)
+        {
+            decoder.decode(block);
+        }
+    }
+    state.counters["minutes_decoded"] = (double)numMinutes / std::max<uint64_t>(state.iterations(), 1);
+}
+BENCHMARK("WwvDecoder::decode", benchDecode);
+
+// An hour of signal through the whole chain, as wwv would
+// decode a recording.
+void benchSyntheticHour(BenchState& state)
+{
+    std::vector<int16_t> audio = syntheticAudio(SYNTHETIC_START, MACRO_SECONDS);
+    std::ostream discard(nullptr);
+
+    state.set_samples_per_iteration(audio.size());
+    int numMinutes = 0;
+    while (state.keep_running())
+    {
+        state.pause_timing();
+        WwvDecoder decoder(DecoderOptions(), discard, [&numMinutes](const DecodedMinute&) { numMinutes++; });
+        state.resume_timing();
+
+        decoder.process(audio.data(), audio.size());
+    }
+    state.counters["minutes_decoded"] = (double)numMinutes / std::max<uint64_t>(state.iterations(), 1);
+    state.counters["real_time_factor"] = state.seconds() > 0 ? state.iterations() * MACRO_SECONDS / state.seconds() : 0;
+}
+BENCHMARK("WwvDecoder::process/synthetic_hour", benchSyntheticHour);
+
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+#include "decoder.h"
+#include "harness.h"
+#include "synthetic.h"
+
+// Micro benchmarks of the decoder's building blocks, each fed
+// the part of a synthetic signal it would see in the decoder.
+// Everything after the bandpass filter runs at SAMPLE_RATE, so
+// one of its samples stands for DECIMATION input samples.
+
+namespace
+{
+
+typedef WwvSymbols<SAMPLE_RATE> Symbols;
+
+const int SIGNAL_SECONDS = 60;
+
+// The signal at the bandpass filter's rate. Dropping samples
+// instead of decimating properly makes no difference to timing.
+std::vector<float> bandpassInput()
+{
+    std::vector<int16_t> audio = syntheticAudio(SYNTHETIC_START, SIGNAL_SECONDS);
+    std::vector<float> input;
+    for (size_t i = 0; i < audio.size(); i += DECIMATION)
+    {
+        input.push_back((float)audio[i] / SHRT_MAX);
+    }
+    return input;
+}
+
+Filter bandpassDesign(int numTaps)
+{
+    DecoderOptions options;
+    return Filter(BPF, numTaps, SAMPLE_RATE, options.bandpassLow, options.bandpassHigh);
+}
+
+void benchFilterDoSample(BenchState& state)
+{
+    std::vector<float> input = bandpassInput();
+    Filter filter = bandpassDesign(DEFAULT_BANDPASS_TAPS);
+
+    state.set_samples_per_iteration(SAMPLE_RATE * DECIMATION);
+    size_t pos = 0;
+    while (state.keep_running())
+    {
+        for (int i = 0; i < SAMPLE_RATE; i++)
+        {
+            doNotOptimize(filter.do_sample(input[pos + i]));
+        }
+        pos = (pos + SAMPLE_RATE) % input.size();
+    }
+}
+BENCHMARK("Filter::do_sample", benchFilterDoSample);
+
+// What the decoder actually uses in place of Filter::do_sample.
+template <typename Engine, int NumTaps>
+void benchBandpass(BenchState& state)
+{
+    std::vector<float> input = bandpassInput();
+    std::vector<float> output(SAMPLE_RATE);
+    Filter design = bandpassDesign(NumTaps);
+    Engine filter(design);
+
+    state.set_samples_per_iteration(SAMPLE_RATE * DECIMATION);
+    size_t pos = 0;
+    while (state.keep_running())
+    {
+        filter.process(&input[pos], output.data(), SAMPLE_RATE);
+        doNotOptimize(output[0]);
+        pos = (pos + SAMPLE_RATE) % input.size();
+    }
+    state.counters["taps"] = NumTaps;
+}
+BENCHMARK("FirFilter::process", benchBandpass<FirFilter, DEFAULT_BANDPASS_TAPS>);
+BENCHMARK("FirFilter::process/long", benchBandpass<FirFilter, FAST_CONVOLUTION_MIN_TAPS * 2 + 1>);
+BENCHMARK("FastConvFilter::process/long", benchBandpass<FastConvFilter, FAST_CONVOLUTION_MIN_TAPS * 2 + 1>);
+
+// The Q15 filter used in fixed point builds, fed the same signal.
+void benchFixedBandpass(BenchState& state)
+{
+    std::vector<float> signal = bandpassInput();
+    std::vector<int16_t> input;
+    for (float sample : signal)
+    {
+        input.push_back(saturate16(lrintf(sample * SHRT_MAX)));
+    }
+    std::vector<int16_t> output(SAMPLE_RATE);
+    Filter design = bandpassDesign(DEFAULT_BANDPASS_TAPS);
+    FixedFirFilter filter(design);
+
+    state.set_samples_per_iteration(SAMPLE_RATE * DECIMATION);
+    size_t pos = 0;
+    while (state.keep_running())
+    {
+        filter.process(&input[pos], output.data(), SAMPLE_RATE);
+        doNotOptimize(output[0]);
+        pos = (pos + SAMPLE_RATE) % input.size();
+    }
+    state.counters["taps"] = DEFAULT_BANDPASS_TAPS;
+}
+BENCHMARK("FixedFirFilter::process", benchFixedBandpass);
+
+// The AGC sees the bandpass output, which is roughly the 100 Hz
+// subcarrier going on and off.
+void benchAgc(BenchState& state)
+{
+    std::vector<float> signal = bandpassInput();
+    std::vector<float> filtered(signal.size());
+    Filter design = bandpassDesign(DEFAULT_BANDPASS_TAPS);
+    FirFilter(design).process(signal.data(), filtered.data(), signal.size());
+
+    std::vector<short> input;
+    for (float sample : filtered)
+    {
+        input.push_back((short)(sample * SHRT_MAX));
+    }
+    std::vector<short> samples(SAMPLE_RATE);
+    BlockAgc agc(1, SAMPLE_RATE);
+
+    state.set_samples_per_iteration(SAMPLE_RATE * DECIMATION);
+    size_t pos = 0;
+    while (state.keep_running())
+    {
+        std::copy(&input[pos], &input[pos] + SAMPLE_RATE, samples.begin());
+        agc.process(samples.data(), SAMPLE_RATE);
+        doNotOptimize(samples[0]);
+        pos = (pos + SAMPLE_RATE) % input.size();
+    }
+}
+BENCHMARK("BlockAgc::process", benchAgc);
+
+void benchTickDetector(BenchState& state)
+{
+    std::vector<int16_t> audio = syntheticAudio(SYNTHETIC_START, SIGNAL_SECONDS);
+    TickDetector detector(INPUT_SAMPLE_RATE);
+
+    state.set_samples_per_iteration(INPUT_SAMPLE_RATE);
+    size_t pos = 0;
+    int numTicks = 0;
+    while (state.keep_running())
+    {
+        for (int i = 0; i < INPUT_SAMPLE_RATE; i++)
+        {
+            numTicks += detector((float)audio[pos + i] / SHRT_MAX);
+        }
+        pos = (pos + INPUT_SAMPLE_RATE) % audio.size();
+    }
+    state.counters["ticks_per_second"] = (double)numTicks / std::max<uint64_t>(state.iterations(), 1);
+}
+BENCHMARK("TickDetector", benchTickDetector);
+
+// The carrier history slides along a sample at a time while the
+// decoder looks for the reference marker, matching each template
+// at every step. Both ways of matching are timed.
+template <typename Symbol>
+void benchFuzzyMatch(BenchState& state)
+{
+    std::vector<float> carrier = syntheticCarrier(SYNTHETIC_START, SIGNAL_SECONDS, SAMPLE_RATE);
+    CarrierHistory<Symbol::LENGTH> history;
+    size_t pos = 0;
+    while (history.size() < Symbol::LENGTH)
+    {
+        history.push_back(carrier[pos++] > 0);
+    }
+
+    state.set_samples_per_iteration(DECIMATION);
+    int numMatches = 0;
+    while (state.keep_running())
+    {
+        history.pop_front();
+        history.push_back(carrier[pos] > 0);
+        pos = pos + 1 == carrier.size() ? 0 : pos + 1;
+        numMatches += fuzzyMatch(history, Symbol::PATTERN);
+    }
+    doNotOptimize(numMatches);
+}
+BENCHMARK("fuzzyMatch/ReferenceMarker", benchFuzzyMatch<Symbols::ReferenceMarker>);
+BENCHMARK("fuzzyMatch/PositionMarker", benchFuzzyMatch<Symbols::PositionMarker>);
+BENCHMARK("fuzzyMatch/OneBit", benchFuzzyMatch<Symbols::OneBit>);
+BENCHMARK("fuzzyMatch/ZeroBit", benchFuzzyMatch<Symbols::ZeroBit>);
+
+template <typename Symbol>
+void benchRunLengthCorrelator(BenchState& state)
+{
+    std::vector<float> carrier = syntheticCarrier(SYNTHETIC_START, SIGNAL_SECONDS, SAMPLE_RATE);
+    RunLengthCorrelator correlator = Symbol::correlator();
+    CarrierHistory<Symbol::LENGTH> history;
+    history.attach(&correlator);
+    size_t pos = 0;
+    while (history.size() < Symbol::LENGTH)
+    {
+        history.push_back(carrier[pos++] > 0);
+    }
+
+    int maxMismatches = Symbol::LENGTH * MAX_MISMATCH_RATIO;
+    state.set_samples_per_iteration(DECIMATION);
+    int numMatches = 0;
+    while (state.keep_running())
+    {
+        history.pop_front();
+        history.push_back(carrier[pos] > 0);
+        pos = pos + 1 == carrier.size() ? 0 : pos + 1;
+        numMatches += correlator.mismatches(history) <= maxMismatches;
+    }
+    doNotOptimize(numMatches);
+}
+BENCHMARK("RunLengthCorrelator/ReferenceMarker", benchRunLengthCorrelator<Symbols::ReferenceMarker>);
+BENCHMARK("RunLengthCorrelator/PositionMarker", benchRunLengthCorrelator<Symbols::PositionMarker>);
+BENCHMARK("RunLengthCorrelator/OneBit", benchRunLengthCorrelator<Symbols::OneBit>);
+BENCHMARK("RunLengthCorrelator/ZeroBit", benchRunLengthCorrelator<Symbols::ZeroBit>);
+
+// Once locked, a second is classified once per second.
+void benchSymbolClassifier(BenchState& state)
+{
+    const size_t maxOffset = SAMPLE_RATE / 50;
+    SymbolClassifier classifier({
+        {'P', Symbols::PositionMarker::ON_SAMPLES, Symbols::PositionMarker::LENGTH},
+        {'1', Symbols::OneBit::ON_SAMPLES, Symbols::OneBit::LENGTH},
+        {'0', Symbols::ZeroBit::ON_SAMPLES, Symbols::ZeroBit::LENGTH},
+        {ERASURE, 0, Symbols::OneBit::LENGTH},
+    }, maxOffset);
+
+    std::vector<float> carrier = syntheticCarrier(SYNTHETIC_START, SIGNAL_SECONDS, SAMPLE_RATE);
+    state.set_samples_per_iteration(INPUT_SAMPLE_RATE);
+    int second = 1;
+    while (state.keep_running())
+    {
+        doNotOptimize(classifier.classify(&carrier[second * SAMPLE_RATE]));
+        second = second % 58 + 1;
+    }
+}
+BENCHMARK("SymbolClassifier::classify", benchSymbolClassifier);
+
+// The time code is decoded once a minute.
+void benchDecodeTimeCode(BenchState& state)
+{
+    std::vector<std::array<char, TIMECODE_LENGTH>> frames(60);
+    TimeCode timeCode = SYNTHETIC_START;
+    for (auto& frame : frames)
+    {
+        frame.fill('0');
+        encodeTimeCode(timeCode, frame);
+        timeCode = nextMinute(timeCode);
+    }
+
+    state.set_samples_per_iteration(60 * INPUT_SAMPLE_RATE);
+    size_t minute = 0;
+    while (state.keep_running())
+    {
+        const auto& frame = frames[minute];
+        if (!hasFieldErasures(frame))
+        {
+            TimeCode decoded = decodeTimeCode(frame);
+            doNotOptimize(decoded);
+            doNotOptimize(isValid(decoded));
+        }
+        minute = minute + 1 == frames.size() ? 0 : minute + 1;
+    }
+}
+BENCHMARK("decodeTimeCode", benchDecodeTimeCode);
+
+}
@@ -0,0 +1,284 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "decoder.h"
+#include "fir.h"
+#include "harness.h"
+
+#ifndef WWV_BUILD_TYPE
+#define WWV_BUILD_TYPE "unknown"
+#endif
+
+namespace
+{
+
+struct Registered
+{
+    const char* name;
+    BenchFunction function;
+};
+
+std::vector<Registered>& registry()
+{
+    static std::vector<Registered> benchmarks;
+    return benchmarks;
+}
+
+struct Result
+{
+    std::string name;
+    uint64_t iterations;
+    double nsPerIteration;
+    double nsPerSample;
+    double samplesPerSecond;
+    std::map<std::string, double> counters;
+};
+
+std::string jsonEscape(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Same layout as Google Benchmark's --benchmark_out, so the same
+// tools can compare two runs.
+void writeJson(std::ostream& out, const std::vector<Result>& results)
+{
+    char date[64];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+
+    const char* kernelName = "";
+    bestDotKernel(&kernelName);
+
+    out << "{\n"
+        << "  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"host_name\": \"" << jsonEscape(host) << "\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+        << "    \"library_build_type\": \"" << WWV_BUILD_TYPE << "\",\n"
+        << "    \"dot_kernel\": \"" << kernelName << "\",\n"
+        << "    \"decimation\": " << DECIMATION << ",\n"
+        << "    \"fixed_point\": " << (WWV_FIXED_POINT ? "true" : "false") << ",\n"
+        << "    \"input_sample_rate\": " << INPUT_SAMPLE_RATE << "\n"
+        << "  },\n"
+        << "  \"benchmarks\": [";
+
+    out << std::setprecision(10);
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\n"
+            << "      \"name\": \"" << jsonEscape(result.name) << "\",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << result.iterations << ",\n"
+            << "      \"real_time\": " << result.nsPerIteration << ",\n"
+            << "      \"time_unit\": \"ns\",\n"
+            << "      \"items_per_second\": " << result.samplesPerSecond << ",\n"
+            << "      \"ns_per_sample\": " << result.nsPerSample;
+        for (auto& counter : result.counters)
+        {
+            out << ",\n      \"" << jsonEscape(counter.first) << "\": " << counter.second;
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void usage(const char* progName)
+{
+    std::cerr << "Usage: " << progName << " [options]" << std::endl
+              << std::endl
+              << "Times the decoder's stages and the whole decoder on a synthetic hour." << std::endl
+              << std::endl
+              << "Options:" << std::endl
+              << "  -f, --filter REGEX   only run benchmarks whose name matches" << std::endl
+              << "  -m, --min-time SECS  run each benchmark at least this long (default 0.5)" << std::endl
+              << "  -j, --json FILE      also write the results to FILE as JSON" << std::endl
+              << "  -l, --list           list the benchmarks and exit" << std::endl
+              << "  -h, --help           show this help" << std::endl;
+}
+
+}
+
+BenchState::BenchState(double minSeconds)
+    : minSeconds_(minSeconds)
+    , iterations_(0)
+    , samplesPerIteration_(0)
+    , started_(false)
+    , paused_(false)
+    , elapsed_(Clock::duration::zero())
+{
+    // Nothing else to do.
+}
+
+bool BenchState::keep_running()
+{
+    Clock::time_point now = Clock::now();
+    if (!started_)
+    {
+        started_ = true;
+        resumed_ = now;
+        return true;
+    }
+
+    iterations_++;
+    if (std::chrono::duration<double>(elapsed_ + (now - resumed_)).count() < minSeconds_)
+    {
+        return true;
+    }
+
+    elapsed_ += now - resumed_;
+    return false;
+}
+
+void BenchState::pause_timing()
+{
+    if (!paused_)
+    {
+        elapsed_ += Clock::now() - resumed_;
+        paused_ = true;
+    }
+}
+
+void BenchState::resume_timing()
+{
+    if (paused_)
+    {
+        resumed_ = Clock::now();
+        paused_ = false;
+    }
+}
+
+double BenchState::seconds() const
+{
+    return std::chrono::duration<double>(elapsed_).count();
+}
+
+int registerBenchmark(const char* name, BenchFunction function)
+{
+    registry().push_back({name, function});
+    return (int)registry().size();
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter = ".";
+    double minSeconds = 0.5;
+    std::string jsonPath;
+    bool list = false;
+
+    const struct option longOptions[] = {
+        {"filter", required_argument, nullptr, 'f'},
+        {"min-time", required_argument, nullptr, 'm'},
+        {"json", required_argument, nullptr, 'j'},
+        {"list", no_argument, nullptr, 'l'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:m:j:lh", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+            case 'f':
+                filter = optarg;
+                break;
+            case 'm':
+                minSeconds = atof(optarg);
+                break;
+            case 'j':
+                jsonPath = optarg;
+                break;
+            case 'l':
+                list = true;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    // Same as the decoder's threads.
+    enableFlushToZero();
+
+    std::regex pattern(filter);
+    std::vector<Result> results;
+
+    if (!list)
+    {
+        std::cout << std::left << std::setw(44) << "Benchmark" << std::right
+                  << std::setw(16) << "Time/iter" << std::setw(12) << "Iterations"
+                  << std::setw(12) << "ns/sample" << std::setw(14) << "samples/s" << std::endl
+                  << std::string(98, '-') << std::endl;
+    }
+
+    for (const Registered& benchmark : registry())
+    {
+        if (!std::regex_search(benchmark.name, pattern)) continue;
+        if (list)
+        {
+            std::cout << benchmark.name << std::endl;
+            continue;
+        }
+
+        BenchState state(minSeconds);
+        benchmark.function(state);
+
+        Result result;
+        result.name = benchmark.name;
+        result.iterations = state.iterations();
+        result.nsPerIteration = state.iterations() > 0 ? state.seconds() * 1e9 / state.iterations() : 0;
+        result.nsPerSample = state.samples() > 0 ? state.seconds() * 1e9 / state.samples() : 0;
+        result.samplesPerSecond = state.seconds() > 0 ? state.samples() / state.seconds() : 0;
+        result.counters = state.counters;
+        results.push_back(result);
+
+        std::cout << std::left << std::setw(44) << result.name << std::right << std::fixed
+                  << std::setw(13) << std::setprecision(0) << result.nsPerIteration << " ns"
+                  << std::setw(12) << result.iterations
+                  << std::setw(12) << std::setprecision(2) << result.nsPerSample
+                  << std::setw(13) << std::setprecision(2) << (result.samplesPerSecond / 1e6) << "M";
+        for (auto& counter : result.counters)
+        {
+            std::cout << "  " << counter.first << "=" << std::defaultfloat << std::setprecision(6) << counter.second;
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream json(jsonPath);
+        if (!json)
+        {
+            std::cerr << jsonPath << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+        writeJson(json, results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef _HARNESS_H
+#define _HARNESS_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+//=========================================================
+// Just enough of a benchmark harness, in the style of
+// Google Benchmark, to time the decoder's stages without
+// pulling in a dependency. A benchmark is a function that
+// sets up and then loops while keep_running() says so:
+//
+//   void bench_something(BenchState& state)
+//   {
+//       ... setup ...
+//       state.set_samples_per_iteration(n);
+//       while (state.keep_running()) { ... process n samples ... }
+//   }
+//   BENCHMARK("Something", bench_something);
+//
+// Throughput is reported per input sample (at
+// INPUT_SAMPLE_RATE). Work done once per second or minute
+// of signal says so through samples per iteration, so that
+// everything is comparable in ns/sample.
+//=========================================================
+class BenchState
+{
+public:
+    explicit BenchState(double minSeconds);
+
+    // True until the benchmark has run for at least the minimum
+    // time (and at least once).
+    bool keep_running();
+
+    // For setup that has to happen inside the loop.
+    void pause_timing();
+    void resume_timing();
+
+    void set_samples_per_iteration(uint64_t samples) { samplesPerIteration_ = samples; }
+
+    // Extra numbers to report, e.g. how many minutes decoded.
+    std::map<std::string, double> counters;
+
+    uint64_t iterations() const { return iterations_; }
+    double seconds() const;
+    uint64_t samples() const { return iterations_ * samplesPerIteration_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    double minSeconds_;
+    uint64_t iterations_;
+    uint64_t samplesPerIteration_;
+    bool started_;
+    bool paused_;
+    Clock::time_point resumed_;
+    Clock::duration elapsed_;
+};
+
+typedef void (*BenchFunction)(BenchState& state);
+
+int registerBenchmark(const char* name, BenchFunction function);
+
+#define BENCHMARK_CONCAT2(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT2(a, b)
+
+// The function may be a template instance, hence the variadic
+// argument (its commas would otherwise split it up).
+#define BENCHMARK(name, ...) \
+    static const int BENCHMARK_CONCAT(benchmarkRegistered, __LINE__) = registerBenchmark(name, __VA_ARGS__)
+
+// Keeps the compiler from optimizing a result away.
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#endif // _HARNESS_H
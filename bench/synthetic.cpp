@@ -0,0 +1,35 @@
+#include "decoder.h"
+#include "synth.h"
+#include "synthetic.h"
+
+std::vector<int16_t> syntheticAudio(const TimeCode& start, int seconds)
+{
+    SynthOptions options;
+    options.start = start;
+    return synthesize(options, seconds);
+}
+
+std::vector<float> syntheticCarrier(const TimeCode& start, int seconds, int sampleRate)
+{
+    std::vector<float> carrier;
+    carrier.reserve((size_t)seconds * sampleRate);
+
+    TimeCode timeCode = start;
+    char frame[TIMECODE_LENGTH];
+    for (int second = 0; second < seconds; second++)
+    {
+        if (second % 60 == 0)
+        {
+            if (second > 0) timeCode = nextMinute(timeCode);
+            buildTimeCodeFrame(timeCode, frame);
+        }
+
+        double end = timeCodePulseEnd(frame, second % 60);
+        for (int i = 0; i < sampleRate; i++)
+        {
+            double t = (double)i / sampleRate;
+            carrier.push_back(t >= TIME_CODE_START && t < end ? 1 : -1);
+        }
+    }
+    return carrier;
+}
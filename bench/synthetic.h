@@ -0,0 +1,23 @@
+#ifndef _SYNTHETIC_H
+#define _SYNTHETIC_H
+
+#include <cstdint>
+#include <vector>
+
+#include "timecode.h"
+
+// What the benchmarks chew on: a clean WWV signal from
+// WwvSynthesizer (see synth.h) starting at the top of the
+// given minute, which the decoder should get every minute
+// of after the first.
+std::vector<int16_t> syntheticAudio(const TimeCode& start, int seconds);
+
+// The same signal's time code carrier at the given rate, as
+// the soft values the decoder keeps (+1 = present, -1 =
+// absent).
+std::vector<float> syntheticCarrier(const TimeCode& start, int seconds, int sampleRate);
+
+// Where the benchmarks start decoding.
+const TimeCode SYNTHETIC_START = {2023, 207, 2, 0, false};
+
+#endif // _SYNTHETIC_H
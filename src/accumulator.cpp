@@ -0,0 +1,139 @@
+#include <cstdlib>
+
+#include "accumulator.h"
+
+namespace
+{
+
+// How much better (in summed soft bits) the winning hypothesis has to
+// be than the runner up. A cleanly received bit is worth about 0.6.
+const float MIN_MARGIN = 1.2f;
+
+const int MINUTES_PER_DAY = 24 * 60;
+
+// Agreement between a field's bits and the given value. Bits that
+// would be 1 add their soft value, bits that would be 0 subtract it.
+template <size_t NumBits>
+float fieldScore(const TimeCodeAccumulator::SoftFrame& soft, const TimeCodeBit (&bits)[NumBits], int value)
+{
+    char expected[TIMECODE_LENGTH];
+    encodeField(expected, bits, value);
+
+    float score = 0;
+    for (auto& bit : bits)
+    {
+        score += expected[bit.index] == '1' ? soft[bit.index] : -soft[bit.index];
+    }
+    return score;
+}
+
+// Tracks the best and second best hypothesis seen.
+struct Ranking
+{
+    float best = -1e30f;
+    float runnerUp = -1e30f;
+    int bestIndex = -1;
+
+    void add(int index, float score)
+    {
+        if (score > best)
+        {
+            runnerUp = best;
+            best = score;
+            bestIndex = index;
+        }
+        else if (score > runnerUp)
+        {
+            runnerUp = score;
+        }
+    }
+
+    bool decisive() const { return best - runnerUp >= MIN_MARGIN; }
+};
+
+}
+
+bool TimeCodeAccumulator::decode(TimeCode& timeCode) const
+{
+    size_t numMinutes = minutes_.size();
+    if (numMinutes == 0)
+    {
+        return false;
+    }
+
+    // Per-minute scores for every value of every field, so each
+    // hypothesis below is just a sum of table lookups.
+    float minuteScores[MAX_MINUTES][60];
+    float hourScores[MAX_MINUTES][24];
+    float dayScores[MAX_MINUTES][367];
+    float yearScores[MAX_MINUTES][100];
+    for (size_t k = 0; k < numMinutes; k++)
+    {
+        for (int v = 0; v < 60; v++) minuteScores[k][v] = fieldScore(minutes_[k], MINUTE_BITS, v);
+        for (int v = 0; v < 24; v++) hourScores[k][v] = fieldScore(minutes_[k], HOUR_BITS, v);
+        for (int v = 1; v <= 366; v++) dayScores[k][v] = fieldScore(minutes_[k], DAY_BITS, v);
+        for (int v = 0; v < 100; v++) yearScores[k][v] = fieldScore(minutes_[k], YEAR_BITS, v);
+    }
+
+    // Time of day of the newest minute. Minute k was sent
+    // (numMinutes - 1 - k) minutes before it.
+    Ranking timeOfDay;
+    for (int hypothesis = 0; hypothesis < MINUTES_PER_DAY; hypothesis++)
+    {
+        float score = 0;
+        for (size_t k = 0; k < numMinutes; k++)
+        {
+            int t = (hypothesis - (int)(numMinutes - 1 - k) + MINUTES_PER_DAY) % MINUTES_PER_DAY;
+            score += minuteScores[k][t % 60] + hourScores[k][t / 60];
+        }
+        timeOfDay.add(hypothesis, score);
+    }
+
+    if (!timeOfDay.decisive())
+    {
+        return false;
+    }
+
+    // Date of the newest minute. Minutes from before midnight carry
+    // the previous day (and possibly year).
+    Ranking date;
+    for (int year = 0; year < 100; year++)
+    {
+        int fullYear = 2000 + year;
+        for (int day = 1; day <= daysInYear(fullYear); day++)
+        {
+            float score = 0;
+            for (size_t k = 0; k < numMinutes; k++)
+            {
+                int minutesBack = numMinutes - 1 - k;
+                int minuteDay = day;
+                int minuteYear = year;
+                if (timeOfDay.bestIndex - minutesBack < 0 && --minuteDay == 0)
+                {
+                    minuteYear = (year + 99) % 100;
+                    minuteDay = daysInYear(2000 + minuteYear);
+                }
+                score += dayScores[k][minuteDay] + yearScores[k][minuteYear];
+            }
+            date.add(year * 367 + day, score);
+        }
+    }
+
+    if (!date.decisive())
+    {
+        return false;
+    }
+
+    timeCode.year = 2000 + date.bestIndex / 367;
+    timeCode.dayOfYear = date.bestIndex % 367;
+    timeCode.hour = timeOfDay.bestIndex / 60;
+    timeCode.minute = timeOfDay.bestIndex % 60;
+
+    float leapVotes = 0;
+    for (size_t k = 0; k < numMinutes; k++)
+    {
+        leapVotes += minutes_[k][LEAP_SECOND_WARNING_BIT];
+    }
+    timeCode.leapSecondWarning = leapVotes > 0;
+    return true;
+}
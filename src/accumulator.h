@@ -0,0 +1,45 @@
+#ifndef _ACCUMULATOR_H
+#define _ACCUMULATOR_H
+
+#include <array>
+#include <cstddef>
+
+#include "ring.h"
+#include "timecode.h"
+
+//=========================================================
+// Decodes the time code by voting across consecutive
+// minutes when no single minute is clean enough on its own.
+//
+// Each minute contributes one soft value per second
+// (positive = looks like a 1, negative = looks like a 0,
+// magnitude = how clearly). Rather than combining bits
+// directly, which wouldn't work for fields that change from
+// minute to minute, every valid time for the newest minute
+// is scored against all stored minutes at once, with each
+// older minute compared to what it must have said at the
+// time: first (hour, minute), then (day, year) given that.
+// Only the last MAX_MINUTES minutes are kept.
+//=========================================================
+class TimeCodeAccumulator
+{
+public:
+    static const size_t MAX_MINUTES = 8;
+
+    typedef std::array<float, TIMECODE_LENGTH> SoftFrame;
+
+    // Adds the minute just received. Minutes must be consecutive,
+    // so call clear() whenever that can't be guaranteed.
+    void add(const SoftFrame& softBits) { minutes_.push_back(softBits); }
+    void clear() { minutes_.clear(); }
+    size_t size() const { return minutes_.size(); }
+
+    // Returns true with the newest minute's time code once the best
+    // hypothesis for every field beats the runner up by a clear margin.
+    bool decode(TimeCode& timeCode) const;
+
+private:
+    FixedRing<SoftFrame, MAX_MINUTES> minutes_;
+};
+
+#endif // _ACCUMULATOR_H
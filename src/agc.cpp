@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+#include "agc.h"
+
+namespace
+{
+
+// -6 dB of full scale.
+const float TARGET = 0.5011872336272722f * SHRT_MAX;
+
+float gainFor(int32_t peak)
+{
+    return TARGET / std::max(peak, 1);
+}
+
+}
+
+BlockAgc::BlockAgc(double holdSeconds, double sampleRate)
+    : halfWindow_(std::max(1, (int)(holdSeconds * sampleRate / 2)))
+    , windowPos_(0)
+    , current_(0)
+    , previous_(0)
+    , pos_(0)
+    , startGain_(gainFor(0))
+    , endGain_(gainFor(0))
+{
+    // Nothing else to do.
+}
+
+void BlockAgc::process(short* samples, size_t count)
+{
+    while (count > 0)
+    {
+        size_t n = std::min<size_t>({count, (size_t)(BLOCK - pos_), (size_t)(halfWindow_ - windowPos_)});
+
+        int32_t peak = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            peak = std::max(peak, std::abs((int32_t)samples[i]));
+        }
+
+        float step = (endGain_ - startGain_) / BLOCK;
+        float gain = startGain_ + step * pos_;
+        if (peak <= std::max(previous_, current_))
+        {
+            // The usual case. The ramp never goes above the gain for
+            // the peak so far, so nothing can overflow.
+            for (size_t i = 0; i < n; i++)
+            {
+                samples[i] = (short)(samples[i] * (gain + step * (i + 1)));
+            }
+        }
+        else
+        {
+            // Louder than anything in the window: cut the gain at
+            // each new peak as it comes, and hold it there for the
+            // rest of the block.
+            for (size_t i = 0; i < n; i++)
+            {
+                int32_t magnitude = std::abs((int32_t)samples[i]);
+                if (magnitude > current_)
+                {
+                    current_ = magnitude;
+                    if (current_ > previous_)
+                    {
+                        startGain_ = endGain_ = gainFor(current_);
+                        gain = startGain_;
+                        step = 0;
+                    }
+                }
+                samples[i] = (short)(samples[i] * (gain + step * (i + 1)));
+            }
+        }
+        current_ = std::max(current_, peak);
+        pos_ += n;
+        windowPos_ += n;
+        samples += n;
+        count -= n;
+
+        if (windowPos_ == halfWindow_)
+        {
+            // Dropping the oldest half window can only raise the gain,
+            // so the ramp already under way can finish as it is.
+            previous_ = current_;
+            current_ = 0;
+            windowPos_ = 0;
+        }
+
+        if (pos_ == BLOCK)
+        {
+            startGain_ = endGain_;
+            endGain_ = gainFor(std::max(previous_, current_));
+            pos_ = 0;
+        }
+    }
+}
+
+double BlockAgc::gain_db() const
+{
+    float gain = startGain_ + (endGain_ - startGain_) * pos_ / BLOCK;
+    return 20 * log10(gain);
+}
@@ -0,0 +1,49 @@
+#ifndef _AGC_H
+#define _AGC_H
+
+#include <cstddef>
+#include <cstdint>
+
+//=========================================================
+// AGC for the envelope detector: brings the bandpass output
+// to -6 dB of full scale, as measured by the peak magnitude
+// over two alternating half windows of the hold time.
+//
+// The gain is only worked out once per BLOCK samples: the
+// peak the half windows hold gives the gain for the end of
+// the next block, and the gain ramps linearly to it in
+// between. Only a new peak changes it in the middle of a
+// block, cutting it straight away so that nothing clips.
+// The half windows themselves are exactly as long as asked
+// for, not whole blocks, so that at any sample rate they stay
+// in step with the once a second carrier they're holding.
+// The dB conversions of a log-domain follower cancel out,
+// leaving one division per block, and the usual per-sample
+// work is a max and a multiply, which vectorize. Blocks are
+// counted from the first sample, so the output doesn't
+// depend on how the input is split up between calls.
+//=========================================================
+class BlockAgc
+{
+public:
+    static const int BLOCK = 32;
+
+    BlockAgc(double holdSeconds, double sampleRate);
+
+    void process(short* samples, size_t count);
+
+    // Current gain, in dB.
+    double gain_db() const;
+
+private:
+    int halfWindow_;
+    int windowPos_;    // in the current half window
+    int32_t current_;  // peak of the current half window
+    int32_t previous_; // and of the one before
+
+    int pos_;          // in the current block
+    float startGain_;  // gain at the start of the block
+    float endGain_;    // and at its end
+};
+
+#endif // _AGC_H
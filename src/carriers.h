@@ -0,0 +1,264 @@
+#ifndef _CARRIERS_H
+#define _CARRIERS_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+//=========================================================
+// Carrier on/off history and symbol templates, stored one
+// bit per sample in 64 bit words so that comparing the two
+// is an XOR + popcount per 64 samples. Both are sized at 
+// compile time and never allocate.
+//=========================================================
+
+// Maximum fraction of samples allowed to differ for a match.
+// Note: 12% is from experimentation based on OTA recordings of WWV.
+const double MAX_MISMATCH_RATIO = 0.12;
+
+// Maximum number of correlators a history can keep up to date.
+const size_t MAX_CORRELATORS = 4;
+
+// Fixed symbol pattern: onCount ones followed by zeros up to
+// Length samples. Bit i of the pattern lives in words[i / 64]
+// at bit position i % 64.
+template <size_t Length>
+struct PackedPattern
+{
+    static constexpr size_t size = Length;
+    
+    std::array<uint64_t, (Length + 63) / 64> words = {};
+    
+    constexpr explicit PackedPattern(size_t onCount)
+    {
+        for (size_t i = 0; i < onCount && i < Length; i++)
+        {
+            words[i >> 6] |= (uint64_t)1 << (i & 63);
+        }
+    }
+    
+    constexpr bool operator[](size_t index) const
+    {
+        return (words[index >> 6] >> (index & 63)) & 1;
+    }
+};
+
+class RunLengthCorrelator;
+
+// Deque-like ring of carrier bits. Capacity is rounded up to a 
+// power of two words and must cover the longest pattern.
+template <size_t CapacityBits>
+class CarrierHistory
+{
+public:
+    static constexpr size_t NUM_WORDS = std::bit_ceil((CapacityBits + 63) / 64);
+    
+    size_t size() const { return tail_ - head_; }
+    bool empty() const { return tail_ == head_; }
+    
+    bool operator[](size_t index) const
+    {
+        size_t pos = (head_ + index) & BIT_MASK;
+        return (words_[pos >> 6] >> (pos & 63)) & 1;
+    }
+    
+    void push_back(bool bit);
+    void pop_front(size_t count = 1);
+    void clear();
+    
+    // Correlators are kept up to date on every push/pop/clear.
+    // Should be done while the history is still empty.
+    void attach(RunLengthCorrelator* correlator)
+    {
+        if (numCorrelators_ < MAX_CORRELATORS)
+        {
+            correlators_[numCorrelators_++] = correlator;
+        }
+    }
+    
+    // Returns the 64 bits starting at index (bit 0 = element index).
+    // Bits past size() are unspecified.
+    uint64_t word_at(size_t index) const
+    {
+        size_t pos = (head_ + index) & BIT_MASK;
+        size_t word = pos >> 6;
+        unsigned shift = pos & 63;
+        uint64_t result = words_[word] >> shift;
+        if (shift != 0)
+        {
+            result |= words_[(word + 1) & WORD_MASK] << (64 - shift);
+        }
+        return result;
+    }
+    
+private:
+    static constexpr size_t WORD_MASK = NUM_WORDS - 1;
+    static constexpr size_t BIT_MASK = NUM_WORDS * 64 - 1;
+    
+    std::array<uint64_t, NUM_WORDS> words_ = {};
+    std::array<RunLengthCorrelator*, MAX_CORRELATORS> correlators_ = {};
+    size_t numCorrelators_ = 0;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+};
+
+//=========================================================
+// Sliding mismatch count against a pattern made of a run of
+// ones followed by a run of zeros (i.e. every WWV symbol).
+// Because the pattern only has one edge, the number of ones
+// in each run's span of the history can be maintained with
+// O(1) work per push or pop instead of rescanning the whole
+// window each time it slides.
+//=========================================================
+class RunLengthCorrelator
+{
+public:
+    constexpr RunLengthCorrelator()
+        : RunLengthCorrelator(0, 0)
+    {
+    }
+    
+    constexpr RunLengthCorrelator(size_t onCount, size_t offCount)
+        : onCount_(onCount)
+        , offCount_(offCount)
+        , onesInOnRun_(0)
+        , onesInOffRun_(0)
+    {
+    }
+    
+    size_t length() const { return onCount_ + offCount_; }
+    
+    // Mismatches over the first min(history size, length()) samples:
+    // zeros in the on run plus ones in the off run.
+    template <typename History>
+    int mismatches(const History& history) const
+    {
+        int onSpan = std::min(history.size(), onCount_);
+        return (onSpan - onesInOnRun_) + onesInOffRun_;
+    }
+    
+    // Same criterion as fuzzyMatch().
+    template <typename History>
+    bool matches(const History& history) const
+    {
+        int maxFailures = std::min(history.size(), length()) * MAX_MISMATCH_RATIO;
+        return mismatches(history) <= maxFailures;
+    }
+    
+    // Called after a bit is appended.
+    template <typename History>
+    void on_push(const History& history)
+    {
+        size_t index = history.size() - 1;
+        if (index < onCount_) onesInOnRun_ += history[index];
+        else if (index < length()) onesInOffRun_ += history[index];
+    }
+    
+    // Called before the front bit is removed. Everything slides down 
+    // by one: the front leaves the on run, the first bit of the off 
+    // run joins the on run and the first bit past the window (if any)
+    // joins the off run.
+    template <typename History>
+    void on_pop(const History& history)
+    {
+        size_t size = history.size();
+        onesInOnRun_ -= history[0];
+        if (size > onCount_)
+        {
+            onesInOnRun_ += history[onCount_];
+            onesInOffRun_ -= history[onCount_];
+        }
+        if (size > length())
+        {
+            onesInOffRun_ += history[length()];
+        }
+    }
+    
+    void reset()
+    {
+        onesInOnRun_ = 0;
+        onesInOffRun_ = 0;
+    }
+    
+private:
+    size_t onCount_;
+    size_t offCount_;
+    int onesInOnRun_;   // ones in [0, onCount_)
+    int onesInOffRun_;  // ones in [onCount_, length())
+};
+
+template <size_t CapacityBits>
+void CarrierHistory<CapacityBits>::push_back(bool bit)
+{
+    size_t pos = tail_ & BIT_MASK;
+    uint64_t mask = (uint64_t)1 << (pos & 63);
+    if (bit) words_[pos >> 6] |= mask;
+    else words_[pos >> 6] &= ~mask;
+    tail_++;
+    
+    for (size_t i = 0; i < numCorrelators_; i++)
+    {
+        correlators_[i]->on_push(*this);
+    }
+}
+
+template <size_t CapacityBits>
+void CarrierHistory<CapacityBits>::pop_front(size_t count)
+{
+    count = std::min(count, size());
+    if (numCorrelators_ == 0)
+    {
+        head_ += count;
+        return;
+    }
+    
+    for (size_t n = 0; n < count; n++)
+    {
+        for (size_t i = 0; i < numCorrelators_; i++)
+        {
+            correlators_[i]->on_pop(*this);
+        }
+        head_++;
+    }
+}
+
+template <size_t CapacityBits>
+void CarrierHistory<CapacityBits>::clear()
+{
+    head_ = tail_ = 0;
+    for (size_t i = 0; i < numCorrelators_; i++)
+    {
+        correlators_[i]->reset();
+    }
+}
+
+// Returns true if <= 12% of the overlapping samples don't match.
+// The pattern length is a compile time constant so the loop bounds
+// are known once the history holds a full symbol.
+template <typename History, size_t Length>
+bool fuzzyMatch(const History& seen, const PackedPattern<Length>& pattern)
+{
+    size_t length = std::min(seen.size(), Length);
+    int maxFailures = length * MAX_MISMATCH_RATIO;
+    int numFailures = 0;
+    
+    size_t fullWords = length >> 6;
+    for (size_t i = 0; i < fullWords; i++)
+    {
+        numFailures += std::popcount(seen.word_at(i << 6) ^ pattern.words[i]);
+        if (numFailures > maxFailures) return false;
+    }
+    
+    size_t remaining = length & 63;
+    if (remaining != 0)
+    {
+        uint64_t mask = ((uint64_t)1 << remaining) - 1;
+        numFailures += std::popcount((seen.word_at(fullWords << 6) ^ pattern.words[fullWords]) & mask);
+    }
+    
+    return numFailures <= maxFailures;
+}
+
+#endif // _CARRIERS_H
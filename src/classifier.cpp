@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "classifier.h"
+
+SymbolClassifier::SymbolClassifier(std::initializer_list<SymbolTemplate> templates, size_t maxOffset)
+    : templates_(templates)
+    , maxOffset_(maxOffset)
+    , windowSize_(0)
+{
+    for (auto& t : templates_)
+    {
+        windowSize_ = std::max(windowSize_, t.length + maxOffset_);
+    }
+
+    prefix_.resize(windowSize_ + 1);
+    bestScore_.resize(templates_.size());
+    bestOffset_.resize(templates_.size());
+}
+
+SymbolDecision SymbolClassifier::score()
+{
+    for (size_t t = 0; t < templates_.size(); t++)
+    {
+        const SymbolTemplate& tmpl = templates_[t];
+        bestScore_[t] = -1e30;
+        bestOffset_[t] = 0;
+
+        for (size_t offset = 0; offset <= maxOffset_; offset++)
+        {
+            double on = prefix_[offset + tmpl.onCount] - prefix_[offset];
+            double off = prefix_[offset + tmpl.length] - prefix_[offset + tmpl.onCount];
+            double score = on - off;
+            if (score > bestScore_[t])
+            {
+                bestScore_[t] = score;
+                bestOffset_[t] = offset;
+            }
+        }
+    }
+
+    size_t best = 0;
+    for (size_t t = 1; t < templates_.size(); t++)
+    {
+        if (bestScore_[t] / templates_[t].length > bestScore_[best] / templates_[best].length)
+        {
+            best = t;
+        }
+    }
+
+    // The most two templates can differ by is the span where one has
+    // carrier and the other doesn't, at full scale in both directions.
+    float confidence = 1;
+    for (size_t t = 0; t < templates_.size(); t++)
+    {
+        if (t == best) continue;
+
+        double span = abs((long)templates_[best].onCount - (long)templates_[t].onCount) +
+            abs((long)templates_[best].length - (long)templates_[t].length);
+        double margin = (bestScore_[best] - bestScore_[t]) / (2 * std::max(span, 1.0));
+        confidence = std::min(confidence, (float)margin);
+    }
+
+    SymbolDecision decision;
+    decision.symbol = templates_[best].symbol;
+    decision.score = bestScore_[best] / templates_[best].length;
+    decision.confidence = std::max(confidence, 0.0f);
+    decision.offset = bestOffset_[best];
+    return decision;
+}
+
+float SymbolClassifier::score(char symbol) const
+{
+    for (size_t t = 0; t < templates_.size(); t++)
+    {
+        if (templates_[t].symbol == symbol)
+        {
+            return bestScore_[t] / templates_[t].length;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef _CLASSIFIER_H
+#define _CLASSIFIER_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+//=========================================================
+// Soft-decision symbol classifier. Every WWV character is a
+// run of carrier followed by a run of silence, so correlating
+// soft carrier values (positive = carrier, negative = none)
+// against a +1/-1 template is
+//
+//     sum(on run) - sum(off run)
+//
+// which is O(1) per template and alignment given prefix sums
+// over the window. One pass over the window therefore scores
+// every candidate at every offset, and the best one is the
+// maximum-likelihood symbol.
+//=========================================================
+struct SymbolTemplate
+{
+    char symbol;
+    size_t onCount;
+    size_t length;
+};
+
+struct SymbolDecision
+{
+    // Template with the highest correlation.
+    char symbol;
+
+    // Its correlation, normalized to -1..1 (1 = perfect match).
+    float score;
+
+    // Margin over the runner up as a fraction of the largest
+    // margin possible between the two templates (0..1).
+    float confidence;
+
+    // Samples from the start of the window to the start of the
+    // symbol.
+    size_t offset;
+};
+
+class SymbolClassifier
+{
+public:
+    SymbolClassifier(std::initializer_list<SymbolTemplate> templates, size_t maxOffset);
+
+    // Samples needed to score every template at every offset.
+    size_t window_size() const { return windowSize_; }
+
+    // Classifies the first window_size() entries of history.
+    template <typename History>
+    SymbolDecision classify(const History& history)
+    {
+        double sum = 0;
+        prefix_[0] = 0;
+        for (size_t i = 0; i < windowSize_; i++)
+        {
+            sum += history[i];
+            prefix_[i + 1] = sum;
+        }
+
+        return score();
+    }
+
+    // Normalized correlation of the given symbol's template at its own
+    // best offset, as of the last classify().
+    float score(char symbol) const;
+
+private:
+    std::vector<SymbolTemplate> templates_;
+    size_t maxOffset_;
+    size_t windowSize_;
+    std::vector<double> prefix_;
+
+    // Best correlation (and where it was found) for each template.
+    std::vector<double> bestScore_;
+    std::vector<size_t> bestOffset_;
+
+    SymbolDecision score();
+};
+
+#endif // _CLASSIFIER_H
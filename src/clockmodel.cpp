@@ -0,0 +1,38 @@
+#include <algorithm>
+
+#include "clockmodel.h"
+
+ClockModel::ClockModel(double sampleRate)
+    : sampleRate_(sampleRate)
+    , valid_(false)
+    , base_(0)
+    , lastReadTime_(0)
+{
+    // Nothing else to do.
+}
+
+void ClockModel::update(double endSample, const timespec& readTime)
+{
+    double now = readTime.tv_sec + readTime.tv_nsec * 1e-9;
+
+    // The read's last sample was captured no later than now.
+    double bound = now - endSample / sampleRate_;
+
+    if (!valid_ || bound < base_)
+    {
+        base_ = bound;
+    }
+    else
+    {
+        double maxCreep = (now - lastReadTime_) * MAX_DRIFT;
+        base_ += std::min(bound - base_, maxCreep);
+    }
+
+    lastReadTime_ = now;
+    valid_ = true;
+}
+
+double ClockModel::realtime(double sample) const
+{
+    return base_ + sample / sampleRate_;
+}
@@ -0,0 +1,50 @@
+#ifndef _CLOCKMODEL_H
+#define _CLOCKMODEL_H
+
+#include <cstdint>
+#include <ctime>
+
+//=========================================================
+// Maps input sample indices to host CLOCK_REALTIME.
+//
+// Each read tells us that all samples read so far had been
+// captured by the time it returned, so every read puts an
+// upper bound on the capture time of its last sample. Any
+// buffering between the sound card and us only ever makes
+// the read later, so the model follows the lowest of these
+// bounds: it drops immediately to any read that arrives
+// earlier than it predicts, and otherwise creeps later at
+// no more than MAX_DRIFT to follow a slow sample clock.
+//=========================================================
+class ClockModel
+{
+public:
+    // Largest sample clock error (either way) that can be followed.
+    static constexpr double MAX_DRIFT = 100e-6;
+
+    explicit ClockModel(double sampleRate);
+
+    // Called after each read: endSample is one past the last
+    // sample read (plus any filter delay, so it may be fractional),
+    // readTime is when the read returned.
+    void update(double endSample, const timespec& readTime);
+
+    // True once there's been at least one update.
+    bool valid() const { return valid_; }
+
+    // Host time (seconds since the epoch) at which the given,
+    // possibly fractional, sample was captured.
+    double realtime(double sample) const;
+
+private:
+    double sampleRate_;
+    bool valid_;
+
+    // Host time of sample 0 according to the model.
+    double base_;
+
+    // Last read, for limiting the drift.
+    double lastReadTime_;
+};
+
+#endif // _CLOCKMODEL_H
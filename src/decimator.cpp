@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include "filt.h"
+#include "decimator.h"
+
+Decimator::Decimator(int factor, int numTaps, double inputRate, double cutoff)
+    : factor_(factor)
+    , tapsPerBranch_((numTaps + factor - 1) / factor)
+    , phase_(0)
+    , pos_(0)
+    , branchTaps_(factor * tapsPerBranch_, 0.0f)
+    , branchHistory_(factor * 2 * tapsPerBranch_, 0.0f)
+    , kernel_(bestDotKernel())
+{
+    Filter lowpass(LPF, numTaps, inputRate, cutoff > 0 ? cutoff : 0.4 * inputRate / factor);
+    if (lowpass.get_error_flag() != 0) return;
+    
+    std::vector<double> taps(numTaps);
+    lowpass.get_taps(taps.data());
+    
+    for (int i = 0; i < numTaps; i++)
+    {
+        int branch = i % factor_;
+        branchTaps_[branch * tapsPerBranch_ + i / factor_] = taps[i];
+    }
+}
+
+size_t Decimator::process(const float* in, size_t count, float* out)
+{
+    size_t numOut = 0;
+    
+    for (size_t i = 0; i < count; i++)
+    {
+        // Output m needs x[mM - p] in branch p, so branch 0 gets the 
+        // sample that completes an output and the others are fed in 
+        // reverse order leading up to it. All branches advance 
+        // together at the start of each round.
+        if (phase_ == factor_ - 1)
+        {
+            pos_ = (pos_ == 0) ? tapsPerBranch_ - 1 : pos_ - 1;
+        }
+        
+        float* history = &branchHistory_[phase_ * 2 * tapsPerBranch_];
+        history[pos_] = in[i];
+        history[pos_ + tapsPerBranch_] = in[i];
+        
+        if (phase_ == 0)
+        {
+            float result = 0;
+            for (int branch = 0; branch < factor_; branch++)
+            {
+                result += kernel_(
+                    &branchHistory_[branch * 2 * tapsPerBranch_ + pos_],
+                    &branchTaps_[branch * tapsPerBranch_],
+                    tapsPerBranch_);
+            }
+            out[numOut++] = result;
+            phase_ = factor_ - 1;
+        }
+        else
+        {
+            phase_--;
+        }
+    }
+    
+    return numOut;
+}
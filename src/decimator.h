@@ -0,0 +1,42 @@
+#ifndef _DECIMATOR_H
+#define _DECIMATOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include "fir.h"
+
+//=========================================================
+// Polyphase FIR decimator. The anti-aliasing lowpass is 
+// split into `factor` branches of num_taps / factor taps
+// each and input samples are dealt out to the branches in
+// turn, so the filter only ever computes the samples that
+// are kept: num_taps / factor multiplies per input sample.
+//=========================================================
+class Decimator
+{
+public:
+    // Designs a lowpass at cutoff Hz, or by default at 40% of
+    // the output rate.
+    Decimator(int factor, int numTaps, double inputRate, double cutoff = 0);
+    
+    int factor() const { return factor_; }
+    
+    // Returns the number of samples written to out, at most
+    // count / factor() + 1.
+    size_t process(const float* in, size_t count, float* out);
+    
+private:
+    int factor_;
+    int tapsPerBranch_;
+    int phase_;     // branch the next input sample goes to
+    int pos_;       // shared write position in each branch history
+    
+    // Branch p holds taps[p], taps[p + factor], ... and a doubled 
+    // history (see FirFilter) of every factor'th input sample.
+    std::vector<float> branchTaps_;
+    std::vector<float> branchHistory_;
+    DotKernel kernel_;
+};
+
+#endif // _DECIMATOR_H
@@ -0,0 +1,1037 @@
+#include <cfloat>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+#include "filt.h"
+#include "decoder.h"
+
+using namespace cycfi::q::literals;
+
+namespace
+{
+
+typedef WwvSymbols<SAMPLE_RATE> Symbols;
+
+const auto& ReferenceMarker = Symbols::ReferenceMarker::PATTERN;
+const auto& PositionMarker = Symbols::PositionMarker::PATTERN;
+const auto& OneBit = Symbols::OneBit::PATTERN;
+
+// The carrier comes up 30ms after the tick, and shows up in the 
+// carrier history some time after that depending on the detector.
+const double CARRIER_DELAY = 0.030;
+const double MAX_DETECTOR_DELAY = 0.100;
+
+// When both stations are heard, their ticks are at most this far
+// apart (the difference between the two path delays).
+const double MAX_PATH_DIFFERENCE = 0.030;
+
+// The tones stop 10ms ahead of each second, and the click where
+// they do can pass for the other station's tick, starting up to a
+// tick length earlier. No ticks are taken from there.
+const double PROTECTED_ZONE = 0.010 + 0.005;
+
+// Ticks further than this from the fitted line are ignored.
+const double MAX_TICK_RESIDUAL = 0.001;
+const size_t MIN_TICKS_PER_MINUTE = 10;
+
+// Seconds 29 and 59 have no tick, so this is the minute's last one.
+const int LAST_TICK_SECOND = 58;
+
+// With a bandpass filter longer than the default, the noise gate's
+// release threshold is kept between these. A filter rings for about
+// as long as it is after anything loud and out of band, such as the
+// ticks, and between pulses the AGC brings that ringing up well
+// clear of the noise. The AGC puts the carrier's envelope at about
+// -7 dB of full scale, so the floor is a fifth of the carrier's
+// level: above the ringing, and low enough that the carrier's edges
+// (which a long filter doesn't smear any more than the default does)
+// only cross it a few ms early or late. Above the ceiling, half the
+// carrier's level, the noise level can only have been measured in
+// the middle of a pulse, as happens on every sample during the phase
+// search, and the gate would cut the next pulses short.
+const float LONG_FILTER_GATE_FLOOR = cycfi::q::lin_float(-20_dB);
+const float LONG_FILTER_GATE_CEILING = cycfi::q::lin_float(-13_dB);
+
+// Noise gate runs shorter than this aren't timed on their own
+// (see decode()).
+const size_t MIN_TIMED_RUN = 16;
+
+// Lowest correlation still taken as a symbol. With hard decisions 
+// this is 25% of the samples disagreeing with the template; looser
+// than fuzzyMatch() since the winner also has to beat the other
+// templates.
+const float MIN_SYMBOL_SCORE = 0.5;
+
+const char* stationName(Station station)
+{
+    return station == WWV ? "WWV" : "WWVH";
+}
+
+}
+
+void DetectorComparison::add(bool envelope, bool quadrature)
+{
+    envelopeHistory.push_back(envelope);
+    quadratureHistory.push_back(quadrature);
+    if (quadratureHistory.full())
+    {
+        // The envelope decision from NUM_LAGS ms ago against the
+        // quadrature decisions up to NUM_LAGS ms either side of it.
+        size_t newest = quadratureHistory.size() - 1;
+        bool delayedEnvelope = envelopeHistory[newest - NUM_LAGS * LAG_STEP];
+        for (int lag = 0; lag < 2 * NUM_LAGS; lag++)
+        {
+            agreements[lag] += quadratureHistory[newest - lag * LAG_STEP] == delayedEnvelope;
+        }
+        numCompared++;
+    }
+    
+    numAdded++;
+    envelopeOn += envelope;
+    quadratureOn += quadrature;
+    envelopeEdges += envelope != lastEnvelope;
+    quadratureEdges += quadrature != lastQuadrature;
+    lastEnvelope = envelope;
+    lastQuadrature = quadrature;
+}
+
+void DetectorComparison::report(std::ostream& out) const
+{
+    long total = std::max(numAdded, 1L);
+    long compared = std::max(numCompared, 1L);
+    int bestLag = std::max_element(agreements, agreements + 2 * NUM_LAGS) - agreements;
+    int lead = bestLag - NUM_LAGS;
+    
+    out << std::fixed << std::setprecision(2)
+        << "A/B: envelope vs. quadrature detector over " << numAdded << " samples" << std::endl
+        << "A/B: agreement " << (100.0 * agreements[bestLag] / compared) << "% "
+        << "(quadrature " << (lead < 0 ? "lagging" : "leading") << " by " << std::abs(lead) << " ms)" << std::endl
+        << "A/B: carrier on " << (100.0 * envelopeOn / total) << "% vs. " 
+        << (100.0 * quadratureOn / total) << "%" << std::endl
+        << "A/B: transitions " << envelopeEdges << " vs. " << quadratureEdges << std::endl;
+}
+
+WwvDecoder::WwvDecoder(const DecoderOptions& options, std::ostream& out, MinuteHandler onMinute)
+    : options_(options)
+    , out_(out)
+    , onMinute_(std::move(onMinute))
+    , metrics_(nullptr)
+    , ng_(-32.5_dB)
+    , gateThreshold_(cycfi::q::lin_float(-32.5_dB))
+    , minGateThreshold_(0)
+    , maxGateThreshold_(FLT_MAX)
+    , decimator_(DECIMATION, 16 * DECIMATION, INPUT_SAMPLE_RATE, DECIMATOR_CUTOFF_HZ)
+    , quadratureDetector_(SAMPLE_RATE)
+    , lookingForPhase_(true)
+    , currentState_(WAITING_FOR_BEGINNING)
+    , dataBitsRemaining_(0)
+    , positionsRemaining_(0)
+    , historyStart_(0)
+    , referenceMarkerCorrelator_(Symbols::ReferenceMarker::correlator())
+    , oneBitCorrelator_(Symbols::OneBit::correlator())
+    , zeroBitCorrelator_(Symbols::ZeroBit::correlator())
+    // Once synced, every second holds P, 1 or 0. These are scored against
+    // each other (and against no carrier at all, which otherwise passes 
+    // for a zero bit) at every alignment within MAX_SYMBOL_OFFSET. The reference
+    // marker only needs its alignment found, since the flywheel already
+    // knows it's due.
+    , secondClassifier_({
+        {'P', Symbols::PositionMarker::ON_SAMPLES, Symbols::PositionMarker::LENGTH},
+        {'1', Symbols::OneBit::ON_SAMPLES, Symbols::OneBit::LENGTH},
+        {'0', Symbols::ZeroBit::ON_SAMPLES, Symbols::ZeroBit::LENGTH},
+        {ERASURE, 0, Symbols::OneBit::LENGTH},
+    }, 2 * MAX_SYMBOL_OFFSET)
+    , referenceClassifier_({
+        {'R', Symbols::ReferenceMarker::ON_SAMPLES, Symbols::ReferenceMarker::LENGTH},
+    }, 2 * MAX_SYMBOL_OFFSET)
+    , erasedSeconds_(0)
+    , haveLastTimeCode_(false)
+    , timeCodeSoft_()
+    , tickDetector_(INPUT_SAMPLE_RATE)
+    , clockModel_(INPUT_SAMPLE_RATE)
+{
+    carriersSeen_.attach(&referenceMarkerCorrelator_);
+    carriersSeen_.attach(&oneBitCorrelator_);
+    carriersSeen_.attach(&zeroBitCorrelator_);
+    
+    Filter bandpassDesign(BPF, options_.bandpassTaps, SAMPLE_RATE, options_.bandpassLow, options_.bandpassHigh);
+    if (bandpassDesign.get_error_flag() != 0)
+    {
+        out_ << "Filter error: " << bandpassDesign.get_error_flag() << std::endl;
+    }
+    
+    // The 1000/1200 Hz tones only fall into nulls of the default
+    // (unwindowed) filter. Longer ones have the taps to spare for a
+    // window, without which the tones leak into the carrier.
+    // They ring for longer, too, which has to be kept out of the
+    // noise gate.
+    if (options_.bandpassTaps > DEFAULT_BANDPASS_TAPS)
+    {
+        bandpassDesign.hamming_window();
+        minGateThreshold_ = LONG_FILTER_GATE_FLOOR;
+        maxGateThreshold_ = LONG_FILTER_GATE_CEILING;
+    }
+    
+    dsp_ = std::make_unique<EnvelopeDsp<DspSample>>(bandpassDesign, 
+        options_.bandpassTaps >= FAST_CONVOLUTION_MIN_TAPS, INPUT_SAMPLE_RATE, SAMPLE_RATE);
+    
+    // CARRIER_DELAY holds for the default bandpass filter. A longer one
+    // delays the carrier by half its extra taps, and fast convolution by
+    // another block, which would push the ticks out of match_tick()'s
+    // window.
+    carrierDelay_ = CARRIER_DELAY;
+    if (options_.detectorMode != QUADRATURE_DETECTOR)
+    {
+        double extraSamples = (options_.bandpassTaps - DEFAULT_BANDPASS_TAPS) / 2.0 + dsp_->bandpass_latency();
+        carrierDelay_ += extraSamples / SAMPLE_RATE;
+    }
+}
+
+void WwvDecoder::update_clock(double endSample, const timespec& readTime)
+{
+    clockModel_.update(endSample, readTime);
+}
+
+// A position marker followed by a zero bit is within MAX_MISMATCH_RATIO
+// of the reference marker, so R also needs the second after the marker
+// to be free of carrier where a data bit pulse would be.
+bool WwvDecoder::reference_marker_seen()
+{
+    return referenceMarkerCorrelator_.matches(carriersSeen_) && !pulse_after_marker(0);
+}
+
+// Whether there's carrier, on the whole, where the data bit pulse
+// of the second after a marker starting at the given sample of
+// the history would be. A real reference marker has its hole there.
+bool WwvDecoder::pulse_after_marker(size_t markerStart) const
+{
+    size_t pulseStart = markerStart + PositionMarker.size;
+    size_t pulseEnd = pulseStart + Symbols::ZeroBit::ON_SAMPLES;
+    float soft = 0;
+    for (size_t i = pulseStart; i < pulseEnd; i++)
+    {
+        soft += softSeen_[i];
+    }
+    
+    return soft > 0;
+}
+
+void WwvDecoder::process_incoming_sample(bool carrierPresent, float soft)
+{
+    carriersSeen_.push_back(carrierPresent ? 1 : 0);
+    softSeen_.push_back(soft);
+    
+    if (currentState_ == WAITING_FOR_BEGINNING && carriersSeen_[0] == 0)
+    {
+        // We should match on the first 1 we see to make the 
+        // rest of the decode logic work reliably. Once locked, 
+        // timing comes from the previous symbol instead.
+        carriersSeen_.pop_front();
+        softSeen_.pop_front();
+        historyStart_++;
+    }
+}
+
+void WwvDecoder::consume_samples(size_t count)
+{
+    count = std::min(count, carriersSeen_.size());
+    carriersSeen_.pop_front(count);
+    softSeen_.pop_front(count);
+    historyStart_ += count;
+}
+
+void WwvDecoder::clear_samples()
+{
+    consume_samples(carriersSeen_.size());
+}
+
+// Remembers the ticks that began the second whose carrier came up
+// at the given sample (at SAMPLE_RATE), if there were any: the
+// strongest one where the carrier says it should be, and the other
+// station's strongest within the path difference of it.
+void WwvDecoder::match_tick(uint64_t carrierStart)
+{
+    if (timeCodeSeen_.empty())
+    {
+        // Reference marker, which starts at second 59 (no tick).
+        return;
+    }
+    
+    double expected = (carrierStart * DECIMATION) - carrierDelay_ * INPUT_SAMPLE_RATE;
+    double earliest = expected - MAX_DETECTOR_DELAY * INPUT_SAMPLE_RATE;
+    
+    const DetectedTick* dominant = nullptr;
+    for (size_t i = 0; i < recentTicks_.size(); i++)
+    {
+        const DetectedTick& tick = recentTicks_[i];
+        if (tick.sample <= expected && tick.sample >= earliest &&
+            (dominant == nullptr || tick.tickToNoise > dominant->tickToNoise))
+        {
+            dominant = &tick;
+        }
+    }
+    if (dominant == nullptr)
+    {
+        return;
+    }
+    minuteTicks_.push_back({(int)timeCodeSeen_.size(), *dominant});
+    
+    // The other station's tick can come later than the carrier 
+    // window, so it's looked for around the dominant one instead.
+    const DetectedTick* other = nullptr;
+    for (size_t i = 0; i < recentTicks_.size(); i++)
+    {
+        const DetectedTick& tick = recentTicks_[i];
+        double later = (tick.sample - dominant->sample) / INPUT_SAMPLE_RATE;
+        if (tick.station != dominant->station && fabs(later) <= MAX_PATH_DIFFERENCE &&
+            !(later < 0 && later >= -PROTECTED_ZONE) &&
+            (other == nullptr || tick.tickToNoise > other->tickToNoise))
+        {
+            other = &tick;
+        }
+    }
+    if (other != nullptr)
+    {
+        minuteTicks_.push_back({(int)timeCodeSeen_.size(), *other});
+    }
+}
+
+// Records the symbol for the current second and moves on to the next 
+// one, which will be due MAX_SYMBOL_OFFSET into the history. Returns 
+// false if too many seconds in a row have been erased to keep going.
+bool WwvDecoder::next_symbol(char symbol, const SymbolDecision& decision, size_t length, float softBit)
+{
+    if (symbol == ERASURE)
+    {
+        if (++erasedSeconds_ > options_.maxErasedSeconds)
+        {
+            return false;
+        }
+        
+        // Nothing to align to, so assume it came exactly when due.
+        emit_event(DecoderEvent::SYMBOL, historyStart_ + MAX_SYMBOL_OFFSET, symbol);
+        match_tick(historyStart_ + MAX_SYMBOL_OFFSET);
+        consume_samples(length);
+    }
+    else
+    {
+        erasedSeconds_ = 0;
+        if (metrics_)
+        {
+            metrics_->mismatchRatio[DecoderMetrics::symbol_index(symbol)].observe((1 - decision.score) / 2);
+        }
+        emit_event(DecoderEvent::SYMBOL, historyStart_ + decision.offset, symbol);
+        match_tick(historyStart_ + decision.offset);
+        consume_samples(decision.offset + length - MAX_SYMBOL_OFFSET);
+    }
+    
+    if (timeCodeSeen_.size() < TIMECODE_LENGTH)
+    {
+        timeCodeSoft_[timeCodeSeen_.size()] = softBit;
+    }
+    timeCodeSeen_.push_back(symbol);
+    out_ << symbol << std::flush;
+    return true;
+}
+
+void WwvDecoder::lose_sync(const char* lostDuring)
+{
+    emit_event(DecoderEvent::LOSS, historyStart_, 0, lostDuring);
+    
+    currentState_ = WAITING_FOR_BEGINNING;
+    timeCodeSeen_.clear();
+    clear_samples();
+    erasedSeconds_ = 0;
+    haveLastTimeCode_ = false;
+    accumulator_.clear();
+    minuteTicks_.clear();
+}
+
+// Sample positions are at SAMPLE_RATE here, as the state machine
+// sees them.
+void WwvDecoder::emit_event(DecoderEvent::Kind kind, uint64_t carrierSample, char symbol, const char* lostDuring)
+{
+    if (metrics_)
+    {
+        count_event(kind, symbol, lostDuring);
+    }
+    
+    if (!onEvent_)
+    {
+        return;
+    }
+    
+    DecoderEvent event = {};
+    event.kind = kind;
+    event.sample = carrierSample * DECIMATION;
+    event.symbol = symbol;
+    event.lostDuring = lostDuring;
+    onEvent_(event);
+}
+
+void WwvDecoder::count_event(DecoderEvent::Kind kind, char symbol, const char* lostDuring)
+{
+    switch (kind)
+    {
+        case DecoderEvent::LOCK:
+            metrics_->locks.add();
+            metrics_->locked.set(1);
+            break;
+        case DecoderEvent::SYMBOL:
+            metrics_->symbols[DecoderMetrics::symbol_index(symbol)].add();
+            metrics_->locked.set(1);
+            break;
+        case DecoderEvent::LOSS:
+            for (size_t i = 0; i < DecoderMetrics::NUM_LOST_DURING; i++)
+            {
+                if (strcmp(lostDuring, DecoderMetrics::LOST_DURING_NAMES[i]) == 0)
+                {
+                    metrics_->losses[i].add();
+                }
+            }
+            metrics_->locked.set(0);
+            break;
+        default:
+            break;
+    }
+}
+
+void WwvDecoder::lap(DecoderMetrics::Stage stage, uint64_t& since)
+{
+    if (metrics_)
+    {
+        uint64_t now = DecoderMetrics::now_nanoseconds();
+        metrics_->stageNanoseconds[stage].add(now - since);
+        since = now;
+    }
+}
+
+void WwvDecoder::parse_time_code()
+{
+    TimeCode timeCode = decodeTimeCode(timeCodeSeen_);
+    
+    out_ << "Date: " << "Day " << timeCode.dayOfYear << " of year " << timeCode.year << std::endl;
+    out_ << "Time (UTC): " << timeCode.hour << ":" << std::setfill('0') << std::setw(2) << timeCode.minute << std::endl;
+}
+
+// Fits a line through the minute's ticks from one station (input
+// sample vs. second). Returns how many ticks went into it, which is
+// fewer than MIN_TICKS_PER_MINUTE if the fit failed. The first
+// character (R) starts in the previous minute, but second 59 has no
+// tick anyway.
+size_t WwvDecoder::fit_ticks(Station station, double& secondZero, double& samplesPerSecond, double& jitter)
+{
+    samplesPerSecond = INPUT_SAMPLE_RATE;
+    size_t numTicks = 0;
+    secondZero = 0;
+    jitter = 0;
+    
+    for (int pass = 0; pass < 2; pass++)
+    {
+        // Second pass drops outliers (e.g. noise taken for a tick).
+        double maxResidual = pass == 0 ? 1e30 : MAX_TICK_RESIDUAL * INPUT_SAMPLE_RATE;
+        double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+        size_t n = 0;
+        for (size_t i = 0; i < minuteTicks_.size(); i++)
+        {
+            if (minuteTicks_[i].tick.station != station) continue;
+            
+            double x = minuteTicks_[i].second;
+            double y = minuteTicks_[i].tick.sample;
+            if (fabs(y - (secondZero + x * samplesPerSecond)) > maxResidual) continue;
+            
+            sumX += x;
+            sumY += y;
+            sumXX += x * x;
+            sumXY += x * y;
+            n++;
+        }
+        
+        if (n < MIN_TICKS_PER_MINUTE)
+        {
+            return n;
+        }
+        
+        samplesPerSecond = (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
+        secondZero = (sumY - samplesPerSecond * sumX) / n;
+        numTicks = n;
+    }
+    
+    double sumSquares = 0;
+    for (size_t i = 0; i < minuteTicks_.size(); i++)
+    {
+        if (minuteTicks_[i].tick.station != station) continue;
+        
+        double residual = minuteTicks_[i].tick.sample - (secondZero + minuteTicks_[i].second * samplesPerSecond);
+        if (fabs(residual) <= MAX_TICK_RESIDUAL * INPUT_SAMPLE_RATE)
+        {
+            sumSquares += residual * residual;
+        }
+    }
+    jitter = sqrt(sumSquares / numTicks) / INPUT_SAMPLE_RATE;
+    return numTicks;
+}
+
+// Reports where second 0 was according to the ticks of whichever
+// station was heard most. If the other one was heard well enough
+// too, how much later its ticks came in is the difference between
+// the two path delays (plus the stations' own offsets from UTC).
+void WwvDecoder::report_on_time_marker(DecodedMinute& minute)
+{
+    const TimeCode& timeCode = minute.timeCode;
+    
+    size_t ticksFrom[NUM_STATIONS] = {};
+    float sumTickToNoise[NUM_STATIONS] = {};
+    for (size_t i = 0; i < minuteTicks_.size(); i++)
+    {
+        const DetectedTick& tick = minuteTicks_[i].tick;
+        ticksFrom[tick.station]++;
+        sumTickToNoise[tick.station] += tick.tickToNoise;
+    }
+    Station station = ticksFrom[WWVH] > ticksFrom[WWV] ? WWVH : WWV;
+    Station other = station == WWV ? WWVH : WWV;
+    
+    minute.station = station;
+    minute.snr = ticksFrom[station] == 0 ? 0 : 20 * log10(sumTickToNoise[station] / ticksFrom[station]);
+    minute.haveSample = false;
+    minute.onTimeSample = -1;
+    
+    // Until the ticks say otherwise: the last second of the minute
+    // has just been decoded, so it began about 59 seconds ago.
+    minute.live = clockModel_.valid();
+    minute.began = minute.live ? clockModel_.realtime((double)historyStart_ * DECIMATION) - 59 : 0;
+    
+    double secondZero, samplesPerSecond, jitter;
+    size_t numTicks = fit_ticks(station, secondZero, samplesPerSecond, jitter);
+    if (numTicks < MIN_TICKS_PER_MINUTE)
+    {
+        out_ << "On-time marker: not enough ticks (" << numTicks << ")" << std::endl;
+        return;
+    }
+    minute.onTimeSample = secondZero;
+    
+    out_ << "On-time marker: sample " << std::fixed << std::setprecision(2) << secondZero 
+              << " (" << stationName(station) << ", " << numTicks << " ticks, jitter " << std::setprecision(1) << (jitter * 1e6) << " us)" << std::endl;
+    
+    double otherSecondZero, otherSamplesPerSecond, otherJitter;
+    if (fit_ticks(other, otherSecondZero, otherSamplesPerSecond, otherJitter) >= MIN_TICKS_PER_MINUTE)
+    {
+        double later = (otherSecondZero - secondZero) / INPUT_SAMPLE_RATE;
+        out_ << stationName(other) << " ticks: " << std::showpos << std::setprecision(2) << (later * 1e3) << " ms" << std::noshowpos << std::endl;
+    }
+    
+    if (clockModel_.valid())
+    {
+        double pathDelay = station == WWV ? options_.wwvDelay : options_.wwvhDelay;
+        double hostTime = clockModel_.realtime(secondZero) - pathDelay;
+        minute.began = hostTime;
+        double offset = toUnixTime(timeCode) - hostTime;
+        out_ << "Host clock offset: " << std::showpos << std::setprecision(6) << offset << " s" << std::noshowpos << std::endl;
+        
+        // The sample is the last tick on the fitted line rather than
+        // second 0: it's a minute fresher for ntpd/chrony, and closer
+        // to the reads the host clock model was fitted from.
+        double sampleTime = clockModel_.realtime(secondZero + LAST_TICK_SECOND * samplesPerSecond) - pathDelay;
+        RefclockSample& sample = minute.sample;
+        sample.clockTime.tv_sec = toUnixTime(timeCode) + LAST_TICK_SECOND;
+        sample.clockTime.tv_nsec = 0;
+        sample.receiveTime.tv_sec = (time_t)floor(sampleTime);
+        sample.receiveTime.tv_nsec = (long)((sampleTime - floor(sampleTime)) * 1e9);
+        sample.precision = jitter > 0 ? std::max(ilogb(jitter), -20) : -20;
+        
+        // WWV announces leap seconds for the whole month; NTP wants 
+        // to hear about it on the day.
+        sample.leap = timeCode.leapSecondWarning && isLastDayOfMonth(timeCode) ? LEAP_INSERT : LEAP_NONE;
+        minute.haveSample = true;
+    }
+    
+    out_ << std::defaultfloat;
+}
+
+// Called once a whole minute has been received. Fills in any erasures
+// from the previous minute if we have it, then outputs the time if 
+// none of the date/time fields are still missing.
+void WwvDecoder::finish_time_code()
+{
+    out_ << std::endl;
+    
+    if (haveLastTimeCode_)
+    {
+        char predicted[TIMECODE_LENGTH];
+        std::copy(lastTimeCode_, lastTimeCode_ + TIMECODE_LENGTH, predicted);
+        encodeTimeCode(nextMinute(decodeTimeCode(lastTimeCode_)), predicted);
+        
+        int numFilled = 0;
+        for (size_t i = 0; i < timeCodeSeen_.size(); i++)
+        {
+            if (timeCodeSeen_[i] == ERASURE && predicted[i] != ERASURE)
+            {
+                timeCodeSeen_[i] = predicted[i];
+                numFilled++;
+            }
+        }
+        
+        if (numFilled > 0)
+        {
+            out_ << "Filled " << numFilled << " erasures from previous minute" << std::endl;
+        }
+    }
+    
+    accumulator_.add(timeCodeSoft_);
+    
+    bool decoded = !hasFieldErasures(timeCodeSeen_) && isValid(decodeTimeCode(timeCodeSeen_));
+    if (!decoded)
+    {
+        // Not enough in this minute alone, so see if the last few 
+        // minutes together agree on a time.
+        TimeCode timeCode;
+        if (accumulator_.decode(timeCode))
+        {
+            out_ << "Voted over " << accumulator_.size() << " minutes" << std::endl;
+            encodeTimeCode(timeCode, timeCodeSeen_);
+            decoded = true;
+        }
+    }
+    
+    if (!decoded)
+    {
+        out_ << "Too many erasures to decode time code" << std::endl;
+        haveLastTimeCode_ = false;
+    }
+    else
+    {
+        parse_time_code();
+        
+        DecodedMinute minute;
+        minute.timeCode = decodeTimeCode(timeCodeSeen_);
+        report_on_time_marker(minute);
+        onMinute_(minute);
+        
+        if (metrics_)
+        {
+            metrics_->timeCodes.add();
+            metrics_->lastTimeCode.set(DecoderMetrics::now_nanoseconds() / 1e9);
+        }
+        
+        if (onEvent_)
+        {
+            DecoderEvent event = {};
+            event.kind = DecoderEvent::TIME_CODE;
+            event.sample = historyStart_ * DECIMATION;
+            event.minute = minute;
+            onEvent_(event);
+        }
+        
+        for (size_t i = 0; i < TIMECODE_LENGTH; i++)
+        {
+            lastTimeCode_[i] = timeCodeSeen_[i];
+        }
+        haveLastTimeCode_ = true;
+    }
+    
+    timeCodeSeen_.clear();
+    minuteTicks_.clear();
+}
+
+bool WwvDecoder::run_state_machine()
+{
+    // Returns true when a symbol decode was attempted, i.e. when the
+    // noise gate threshold should be retuned.
+    bool adjustNoiseGate = false;
+    
+    switch (currentState_)
+    {
+        case WAITING_FOR_BEGINNING:
+            if (carriersSeen_.size() == ReferenceMarker.size)
+            {
+                adjustNoiseGate = true;
+                
+                int numCarriersToPop = 0;
+                if (reference_marker_seen())
+                {
+                    // Seen reference marker, now listen for first data bits
+                    dataBitsRemaining_ = 8;
+                    positionsRemaining_ = 5; // Expecting five more position bits
+                    currentState_ = WAITING_FOR_DATA;
+                
+                    out_ << std::endl;
+                    if (metrics_)
+                    {
+                        int mismatches = referenceMarkerCorrelator_.mismatches(carriersSeen_);
+                        metrics_->mismatchRatio[DecoderMetrics::symbol_index('R')].observe((double)mismatches / ReferenceMarker.size);
+                    }
+                    emit_event(DecoderEvent::SYMBOL, historyStart_, 'R');
+                    timeCodeSeen_.push_back('R');
+                    out_ << "R" << std::flush;
+                    
+                    // Since we're sync'd up with the radio now, we can shortcut the
+                    // rest of the matching. Leave MAX_SYMBOL_OFFSET behind so the
+                    // first data bit can be aligned either way.
+                    numCarriersToPop = carriersSeen_.size() - MAX_SYMBOL_OFFSET;
+                    lookingForPhase_ = false;
+                }
+                else if (lookingForPhase_ && (
+                    oneBitCorrelator_.matches(carriersSeen_) || 
+                    zeroBitCorrelator_.matches(carriersSeen_) ||
+                    referenceMarkerCorrelator_.matches(carriersSeen_)))
+                {
+                    // Another way we can shortcut the phase search is finding 1, 0 or P.
+                    // However, we still need to find R to start being able to read the time.
+                    out_ << "Locked onto WWV signal" << std::endl;
+                    emit_event(DecoderEvent::LOCK, historyStart_);
+                    numCarriersToPop = OneBit.size;
+                    lookingForPhase_ = false;
+                }
+                else
+                {
+                    // The channel was too noisy to receive the reference marker
+                    // (or we started listening in the middle of a time code).
+                    // Only pop the beginning of the list in case of the latter.
+                    consume_samples(1);
+                }
+                
+                if (!lookingForPhase_)
+                {
+                    consume_samples(numCarriersToPop);
+                }
+            }
+            break;
+        case WAITING_FOR_REFERENCE:
+            if (carriersSeen_.size() == referenceClassifier_.window_size())
+            {
+                adjustNoiseGate = true;
+                
+                SymbolDecision decision = referenceClassifier_.classify(softSeen_);
+                char symbol = decision.score >= MIN_SYMBOL_SCORE ? 'R' : ERASURE;
+                
+                // A pulse in the hole means the minute was read a second or
+                // more out of phase, with a position marker and the bit after
+                // it taken for R. The flywheel would only carry that on.
+                bool outOfPhase = pulse_after_marker(decision.offset);
+                
+                out_ << std::endl;
+                if (!outOfPhase && next_symbol(symbol, decision, ReferenceMarker.size))
+                {
+                    dataBitsRemaining_ = 8;
+                    positionsRemaining_ = 5;
+                    currentState_ = WAITING_FOR_DATA;
+                }
+                else
+                {
+                    out_ << "lost sync during reference wait" << std::endl;
+                    lose_sync("reference");
+                    lookingForPhase_ = true;
+                }
+            }
+            break;
+        case WAITING_FOR_DATA:
+            if (carriersSeen_.size() == secondClassifier_.window_size())
+            {
+                adjustNoiseGate = true;
+                
+                SymbolDecision decision = secondClassifier_.classify(softSeen_);
+                char symbol = decision.symbol;
+                if (symbol == 'P' || decision.score < MIN_SYMBOL_SCORE)
+                {
+                    symbol = ERASURE;
+                }
+                
+                // How much more this looks like a 1 than a 0, even if it 
+                // couldn't be decoded as either.
+                float softBit = secondClassifier_.score('1') - secondClassifier_.score('0');
+                if (next_symbol(symbol, decision, OneBit.size, softBit))
+                {
+                    dataBitsRemaining_--;
+                    if (dataBitsRemaining_ == 0)
+                    {
+                        if (positionsRemaining_ == 0)
+                        {
+                            // We should have a full timecode now; print it out and 
+                            // pass it on.
+                            finish_time_code();
+                            
+                            // The next minute's reference marker follows immediately,
+                            // so there's no need to search for it again.
+                            currentState_ = options_.maxErasedSeconds > 0 ? WAITING_FOR_REFERENCE : WAITING_FOR_BEGINNING;
+                            if (currentState_ == WAITING_FOR_BEGINNING)
+                            {
+                                // No telling which minute will be next.
+                                clear_samples();
+                                accumulator_.clear();
+                            }
+                        }
+                        else
+                        {
+                            // We need to see another position marker now
+                            currentState_ = WAITING_FOR_POSITION;
+                        }
+                    }
+                }
+                else
+                {
+                    // We lost the WWV signal, so wait for another reference marker
+                    out_ << std::endl << "lost sync during data wait" << std::endl;
+                    lose_sync("data");
+                    lookingForPhase_ = true;
+                }
+            }
+            break;
+        case WAITING_FOR_POSITION:
+            if (carriersSeen_.size() == secondClassifier_.window_size())
+            {
+                adjustNoiseGate = true;
+                
+                SymbolDecision decision = secondClassifier_.classify(softSeen_);
+                char symbol = decision.symbol;
+                if (symbol != 'P' || decision.score < MIN_SYMBOL_SCORE)
+                {
+                    symbol = ERASURE;
+                }
+                
+                if (next_symbol(symbol, decision, PositionMarker.size))
+                {
+                    dataBitsRemaining_ = 9;
+                    positionsRemaining_--;
+                    currentState_ = WAITING_FOR_DATA;
+                }
+                else
+                {
+                    // We lost the WWV signal, so wait for another reference marker
+                    out_ << std::endl << "lost sync during position wait" << std::endl;
+                    lose_sync("position");
+                    lookingForPhase_ = false;
+                }
+            }
+            break;
+    };
+    
+    return adjustNoiseGate;
+}
+
+// Samples that can go into the carrier history before the state
+// machine can next attempt a decode, which it does once the history
+// is as long as the current state's window.
+size_t WwvDecoder::samples_until_decode() const
+{
+    size_t windowSize;
+    switch (currentState_)
+    {
+        case WAITING_FOR_BEGINNING:
+            windowSize = ReferenceMarker.size;
+            break;
+        case WAITING_FOR_REFERENCE:
+            windowSize = referenceClassifier_.window_size();
+            break;
+        default:
+            windowSize = secondClassifier_.window_size();
+            break;
+    }
+    return windowSize > carriersSeen_.size() ? windowSize - carriersSeen_.size() : 1;
+}
+
+//=========================================================
+// Block processing. Each stage below runs over a whole span
+// of samples before the next one starts so that the per-stage
+// loops stay tight and call overhead is paid once per buffer.
+// The noise gate is the exception: the state machine retunes 
+// its threshold after every symbol decode attempt, so it only
+// gates up to where the next attempt can be at a time (see
+// decode()). detect() stops before it and decode() takes over.
+//=========================================================
+
+void WwvDecoder::dc_block_stage(const int16_t* in, DspSample* out, size_t count)
+{
+    dsp_->dc_block(in, out, count);
+}
+
+void WwvDecoder::tick_stage(const DspSample* in, size_t count, CarrierBlock& block)
+{
+    block.numTicks = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t numTicks = tickDetector_((float)in[i] / SHRT_MAX);
+        for (size_t j = 0; j < numTicks && block.numTicks < CarrierBlock::MAX_TICKS; j++)
+        {
+            block.ticks[block.numTicks++] = tickDetector_.tick(j);
+        }
+    }
+}
+
+void WwvDecoder::bandpass_stage(const DspSample* in, short* out, float* scratch, size_t count)
+{
+    dsp_->bandpass(in, out, scratch, count);
+}
+
+void WwvDecoder::agc_stage(short* samples, size_t count)
+{
+    dsp_->agc(samples, count);
+    if (metrics_ && count > 0)
+    {
+        metrics_->agcGain.set(dsp_->agc_gain_db());
+    }
+}
+
+void WwvDecoder::envelope_stage(const short* in, float* envelope, float* noiseLevel, size_t count)
+{
+    dsp_->envelope(in, envelope, noiseLevel, count);
+}
+
+void WwvDecoder::noise_gate_stage(const float* envelope, const bool* compareWith, bool* carrierPresent, float* soft, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        carrierPresent[i] = ng_(envelope[i]);
+        if (compareWith != nullptr)
+        {
+            detectorComparison_.add(carrierPresent[i], compareWith[i]);
+        }
+        
+        // Soft value is how far the envelope is above or below the
+        // gate's release threshold.
+        soft[i] = (envelope[i] - gateThreshold_) / (envelope[i] + gateThreshold_);
+    }
+}
+
+void WwvDecoder::quadrature_stage(const float* in, bool* carrierPresent, float* soft, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        carrierPresent[i] = quadratureDetector_(in[i]);
+        soft[i] = std::clamp(2 * quadratureDetector_.soft(), -1.0f, 1.0f);
+    }
+}
+
+// Returns whether a decode was attempted on the last sample.
+bool WwvDecoder::carrier_stage(const bool* carrierPresent, const float* soft, size_t count)
+{
+    bool attempted = false;
+    for (size_t i = 0; i < count; i++)
+    {
+        process_incoming_sample(carrierPresent[i], soft[i]);
+        attempted = run_state_machine();
+    }
+    return attempted;
+}
+
+void WwvDecoder::process(const int16_t* samples, size_t count)
+{
+    while (count > 0)
+    {
+        size_t blockSize = std::min(count, CarrierBlock::MAX_SAMPLES);
+        
+        detect(samples, blockSize, block_);
+        decode(block_);
+        
+        samples += blockSize;
+        count -= blockSize;
+    }
+}
+
+void WwvDecoder::detect(const int16_t* samples, size_t count, CarrierBlock& block)
+{
+    uint64_t since = metrics_ ? DecoderMetrics::now_nanoseconds() : 0;
+    dc_block_stage(samples, blocked_, count);
+    lap(DecoderMetrics::DC_BLOCK_STAGE, since);
+    tick_stage(blocked_, count, block);
+    lap(DecoderMetrics::TICK_STAGE, since);
+    
+    // Everything below runs at SAMPLE_RATE. The decimator and the
+    // quadrature detector are floating point, so fixed point samples
+    // are converted for them (float ones pass straight through).
+    const DspSample* bandpassIn = blocked_;
+    const float* quadratureIn = nullptr;
+    block.count = count;
+    if constexpr (DECIMATION > 1)
+    {
+        block.count = decimator_.process(toFloatSamples(blocked_, floatBlocked_, count), count, decimated_);
+        quadratureIn = decimated_;
+        if (options_.detectorMode != QUADRATURE_DETECTOR)
+        {
+            bandpassIn = fromFloatSamples(decimated_, dspDecimated_, block.count);
+        }
+        lap(DecoderMetrics::DECIMATE_STAGE, since);
+    }
+    
+    if (options_.detectorMode != ENVELOPE_DETECTOR)
+    {
+        if (quadratureIn == nullptr)
+        {
+            quadratureIn = toFloatSamples(blocked_, floatBlocked_, count);
+        }
+        quadrature_stage(quadratureIn, block.carrierPresent, block.soft, block.count);
+        lap(DecoderMetrics::QUADRATURE_STAGE, since);
+    }
+    
+    if (options_.detectorMode != QUADRATURE_DETECTOR)
+    {
+        bandpass_stage(bandpassIn, filtered_, scratch_, block.count);
+        lap(DecoderMetrics::BANDPASS_STAGE, since);
+        agc_stage(filtered_, block.count);
+        lap(DecoderMetrics::AGC_STAGE, since);
+        envelope_stage(filtered_, block.envelope, block.noiseLevel, block.count);
+        lap(DecoderMetrics::ENVELOPE_STAGE, since);
+    }
+    
+    if (metrics_)
+    {
+        metrics_->samples.add(count);
+        for (size_t i = 0; i < block.numTicks; i++)
+        {
+            metrics_->ticks[block.ticks[i].station].add(1);
+        }
+    }
+}
+
+void WwvDecoder::decode(const CarrierBlock& block)
+{
+    uint64_t since = metrics_ ? DecoderMetrics::now_nanoseconds() : 0;
+    for (size_t i = 0; i < block.numTicks; i++)
+    {
+        recentTicks_.push_back(block.ticks[i]);
+    }
+    
+    if (options_.detectorMode == QUADRATURE_DETECTOR)
+    {
+        // The quadrature detector tracks its own threshold, so there's
+        // nothing to retune after a decode attempt.
+        carrier_stage(block.carrierPresent, block.soft, block.count);
+        lap(DecoderMetrics::DECODE_STAGE, since);
+        return;
+    }
+    
+    // No decode attempt, and so no retuning, can come before
+    // samples_until_decode() more samples, so that many are gated
+    // in one go.
+    const bool* compareWith = options_.detectorMode == AB_COMPARE_DETECTORS ? block.carrierPresent : nullptr;
+    for (size_t i = 0, run = 0; i < block.count; i += run)
+    {
+        run = std::min(block.count - i, samples_until_decode());
+        
+        // During the phase search a decode is attempted on every 
+        // sample, and a clock read costs more than gating one. 
+        // Runs that short are counted as decoding.
+        bool timed = run >= MIN_TIMED_RUN;
+        if (timed) lap(DecoderMetrics::DECODE_STAGE, since);
+        
+        noise_gate_stage(block.envelope + i, compareWith ? compareWith + i : nullptr, gated_, gatedSoft_, run);
+        if (timed) lap(DecoderMetrics::NOISE_GATE_STAGE, since);
+        
+        if (carrier_stage(gated_, gatedSoft_, run))
+        {
+            // Adjust noise gate threshold for next go-around.
+            float noiseLevel = std::clamp(block.noiseLevel[i + run - 1], minGateThreshold_, maxGateThreshold_);
+            ng_.release_threshold(cycfi::q::lin_to_db(noiseLevel));
+            gateThreshold_ = noiseLevel;
+            if (metrics_)
+            {
+                metrics_->noiseGateThreshold.set(20 * log10(std::max(noiseLevel, 1e-10f)));
+            }
+        }
+    }
+    lap(DecoderMetrics::DECODE_STAGE, since);
+}
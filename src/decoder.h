@@ -0,0 +1,386 @@
+#ifndef _DECODER_H
+#define _DECODER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+
+#include <type_traits>
+
+#include <q/fx/noise_gate.hpp>
+
+#include "dsp.h"
+#include "decimator.h"
+#include "detector.h"
+#include "carriers.h"
+#include "ring.h"
+#include "symbols.h"
+#include "classifier.h"
+#include "timecode.h"
+#include "accumulator.h"
+#include "tick.h"
+#include "clockmodel.h"
+#include "refclock.h"
+#include "metrics.h"
+
+// Input is 16 bit mono at INPUT_SAMPLE_RATE. Everything from the
+// bandpass filter onwards runs at SAMPLE_RATE, which is reduced by
+// building with WWV_DECIMATION > 1 (see src/CMakeLists.txt).
+#ifndef WWV_DECIMATION
+#define WWV_DECIMATION 1
+#endif
+
+const int INPUT_SAMPLE_RATE = 8000;
+const int DECIMATION = WWV_DECIMATION;
+const int SAMPLE_RATE = INPUT_SAMPLE_RATE / DECIMATION;
+static_assert(INPUT_SAMPLE_RATE % DECIMATION == 0, "decimation must divide the input rate");
+
+// At 1 KHz the 2ms envelope follower is only two samples long, and
+// noise gets through the noise gate between pulses at signal levels
+// that decode cleanly at 2 KHz.
+static_assert(DECIMATION <= 4, "the detector needs at least 2 KHz");
+
+// Building with WWV_FIXED_POINT=1 runs the envelope detector's
+// DSP in Q15 integers instead of float (see EnvelopeDsp), for
+// CPUs without a fast FPU.
+#ifndef WWV_FIXED_POINT
+#define WWV_FIXED_POINT 0
+#endif
+
+typedef std::conditional<WWV_FIXED_POINT, int16_t, float>::type DspSample;
+
+// Nothing above the 600 Hz tones is needed once decimated (the second
+// ticks are found before that), so the decimator's lowpass stops at
+// 800 Hz even where the output rate would allow more. That keeps the
+// 1000 and 1200 Hz ticks and minute tones out of the bandpass filter,
+// which can't reject them well enough by itself at 4 KHz.
+const double DECIMATOR_CUTOFF_HZ = std::min(0.4 * SAMPLE_RATE, 800.0);
+
+// Bandpass around the 100 Hz subcarrier. The default length is the
+// same in time (~32ms) regardless of decimation. Filters longer than
+// FAST_CONVOLUTION_MIN_TAPS use overlap-save fast convolution instead
+// of direct form.
+const int DEFAULT_BANDPASS_TAPS = (255 / DECIMATION) | 1;
+const int FAST_CONVOLUTION_MIN_TAPS = 512;
+
+// The fixed point build has neither fast convolution nor a SIMD
+// kernel for its direct form filter, which already costs twice as
+// much per tap as the float one, so it stops short of the lengths
+// that would use fast convolution.
+const int MAX_BANDPASS_TAPS = WWV_FIXED_POINT ? FAST_CONVOLUTION_MIN_TAPS - 1 : MAX_NUM_FILTER_TAPS - 1;
+
+// How carrier presence is decided. The envelope detector is the
+// bandpass + AGC + envelope follower + noise gate chain; the
+// quadrature detector replaces all of that with an I/Q mixer at
+// 100 Hz. The A/B mode decodes with the former and reports how
+// well the latter agrees with it.
+enum DetectorMode
+{
+    ENVELOPE_DETECTOR,
+    QUADRATURE_DETECTOR,
+    AB_COMPARE_DETECTORS,
+};
+
+struct DecoderOptions
+{
+    int bandpassTaps = DEFAULT_BANDPASS_TAPS;
+    double bandpassLow = 75;
+    double bandpassHigh = 150;
+    DetectorMode detectorMode = ENVELOPE_DETECTOR;
+
+    // Flywheel: once locked, seconds that can't be decoded are
+    // recorded as erasures and timing carries on from the last good
+    // symbol, for up to this many seconds in a row (0 = off).
+    int maxErasedSeconds = 60;
+
+    // How long each station's signal takes to get here (seconds).
+    // Taken off the host timestamp of each minute, according to
+    // the station whose ticks timed it.
+    double wwvDelay = 0;
+    double wwvhDelay = 0;
+};
+
+// What a decoder made of one minute.
+struct DecodedMinute
+{
+    TimeCode timeCode;
+
+    // Average tick-to-noise ratio of the minute's ticks in dB,
+    // 0 if there weren't any.
+    float snr;
+
+    // Host time (seconds since the epoch) at which the minute began,
+    // if the input is live. Only accurate to within a second or so
+    // unless haveSample is set.
+    bool live;
+    double began;
+
+    // Whether the on-time marker was timestamped against the host
+    // clock, i.e. whether sample is filled in. Only live input
+    // has a host clock to timestamp against.
+    bool haveSample;
+    RefclockSample sample;
+
+    // Input sample at which the minute began according to its
+    // ticks, -1 if there weren't enough of them, and the station
+    // those ticks came from (whichever was heard most). The sample
+    // is when the minute arrived; only the host timestamps have
+    // the path delay taken off.
+    double onTimeSample;
+    Station station;
+};
+
+// Something the state machine did, for event logs (see Replay).
+struct DecoderEvent
+{
+    enum Kind
+    {
+        LOCK,      // found where the seconds begin
+        SYMBOL,    // decoded (or erased) a second
+        TIME_CODE, // decoded a minute
+        LOSS,      // lost sync
+    };
+
+    Kind kind;
+
+    // Input sample where it happened (for symbols, where the
+    // carrier came up).
+    uint64_t sample;
+
+    char symbol;            // SYMBOL
+    const char* lostDuring; // LOSS: what was being waited for
+    DecodedMinute minute;   // TIME_CODE
+};
+
+//=========================================================
+// What the first half of the decoder (the tick and carrier
+// detectors, which don't depend on the state machine) made
+// of up to MAX_SAMPLES input samples, for the second half.
+// Which of the per-sample arrays are filled in depends on
+// the detector mode.
+//=========================================================
+struct CarrierBlock
+{
+    static const size_t MAX_SAMPLES = 1024;
+    static const size_t MAX_TICKS = 4;
+
+    // Samples at SAMPLE_RATE.
+    size_t count;
+
+    // Quadrature detector
+    bool carrierPresent[MAX_SAMPLES];
+    float soft[MAX_SAMPLES];
+
+    // Envelope detector, before the noise gate
+    float envelope[MAX_SAMPLES];
+    float noiseLevel[MAX_SAMPLES];
+
+    size_t numTicks;
+    DetectedTick ticks[MAX_TICKS];
+};
+
+//=========================================================
+// Statistics for comparing the two detectors. The detectors
+// have different (fixed) delays, so agreement is tracked for
+// a range of lags and the best one is reported.
+//=========================================================
+struct DetectorComparison
+{
+    static const int LAG_STEP = SAMPLE_RATE / 1000;  // 1ms
+    static const int NUM_LAGS = 64;  // either way
+
+    FixedRing<char, 2 * LAG_STEP * NUM_LAGS> envelopeHistory;
+    FixedRing<char, 2 * LAG_STEP * NUM_LAGS> quadratureHistory;
+    long agreements[2 * NUM_LAGS] = {};  // quadrature leading by index - NUM_LAGS ms
+    long numAdded = 0;
+    long numCompared = 0;
+    long envelopeOn = 0, quadratureOn = 0;
+    long envelopeEdges = 0, quadratureEdges = 0;
+    bool lastEnvelope = false, lastQuadrature = false;
+
+    void add(bool envelope, bool quadrature);
+    void report(std::ostream& out) const;
+};
+
+//=========================================================
+// Decodes one input stream: everything from 16 bit audio at
+// INPUT_SAMPLE_RATE to time codes and on-time markers. All
+// state lives in the object, so any number of decoders can
+// run side by side (e.g. one per thread, each listening to
+// a different WWV frequency). Progress is written to the
+// given stream and every decoded minute is passed to the
+// handler, both on the thread calling process().
+//=========================================================
+class WwvDecoder
+{
+public:
+    typedef std::function<void(const DecodedMinute&)> MinuteHandler;
+    typedef std::function<void(const DecoderEvent&)> EventHandler;
+
+    WwvDecoder(const DecoderOptions& options, std::ostream& out, MinuteHandler onMinute);
+
+    // Runs a span of input samples through the decoder.
+    void process(const int16_t* samples, size_t count);
+
+    // process() in two halves, which may run on different threads
+    // (see Pipeline) as long as each half stays on one. detect()
+    // takes at most CarrierBlock::MAX_SAMPLES samples.
+    void detect(const int16_t* samples, size_t count, CarrierBlock& block);
+    void decode(const CarrierBlock& block);
+
+    // Called after each read of live input: endSample is one past
+    // the last sample read (see ClockModel::update()), readTime is
+    // when the read returned.
+    void update_clock(double endSample, const timespec& readTime);
+
+    // Also passes every event to the handler, on the thread calling
+    // process()/decode().
+    void set_event_handler(EventHandler onEvent) { onEvent_ = std::move(onEvent); }
+
+    // Also keeps the given metrics up to date (nullptr for none).
+    // detect() and decode() each write their own, so they can be
+    // read from any thread.
+    void set_metrics(DecoderMetrics* metrics) { metrics_ = metrics; }
+
+    DetectorMode detector_mode() const { return options_.detectorMode; }
+    const DetectorComparison& detector_comparison() const { return detectorComparison_; }
+
+private:
+    WwvDecoder(const WwvDecoder&) = delete;
+    WwvDecoder& operator=(const WwvDecoder&) = delete;
+
+    typedef WwvSymbols<SAMPLE_RATE> Symbols;
+
+    // Once synced, symbols are looked for starting 10ms before they're
+    // due, up to 10ms after.
+    static constexpr size_t MAX_SYMBOL_OFFSET = SAMPLE_RATE / 100;
+
+    // Carrier history only ever needs to hold the longest symbol plus
+    // the alignment search around it.
+    static constexpr size_t HISTORY_LENGTH = Symbols::MAX_LENGTH + 2 * MAX_SYMBOL_OFFSET;
+
+    enum State
+    {
+        WAITING_FOR_BEGINNING, // Haven't seen the reference marker yet
+        WAITING_FOR_DATA,      // Data bits in between position markers
+                               // (8 if we came from WAITING_FOR_BEGINNING,
+                               // 9 otherwise).
+        WAITING_FOR_POSITION,  // Waiting for position marker
+        WAITING_FOR_REFERENCE, // Still locked from the previous minute, so the
+                               // next reference marker is due right now.
+    };
+
+    struct SecondTick
+    {
+        int second;
+        DetectedTick tick;
+    };
+
+    DecoderOptions options_;
+    std::ostream& out_;
+    MinuteHandler onMinute_;
+    EventHandler onEvent_;
+    DecoderMetrics* metrics_;
+
+    // Carrier detection
+    std::unique_ptr<EnvelopeDsp<DspSample>> dsp_;
+    double carrierDelay_; // seconds, from the tick to the carrier history
+    cycfi::q::noise_gate ng_;
+    float gateThreshold_; // tracks ng_'s release threshold
+    float minGateThreshold_; // and is kept between these
+    float maxGateThreshold_;
+    Decimator decimator_;
+    QuadratureDetector quadratureDetector_;
+    DetectorComparison detectorComparison_;
+
+    // Symbol decoding
+    FixedRing<char, 60> timeCodeSeen_; // one minute's worth of symbols
+    bool lookingForPhase_;
+    State currentState_;
+    int dataBitsRemaining_;
+    int positionsRemaining_;
+
+    CarrierHistory<HISTORY_LENGTH> carriersSeen_;
+
+    // Soft carrier values (-1 = definitely absent, +1 = definitely present),
+    // kept in lockstep with carriersSeen_.
+    FixedRing<float, HISTORY_LENGTH> softSeen_;
+
+    // Sample index (at SAMPLE_RATE) of carriersSeen_[0].
+    uint64_t historyStart_;
+
+    // Sliding matchers used during the phase search, where the window
+    // moves by one sample at a time.
+    RunLengthCorrelator referenceMarkerCorrelator_;
+    RunLengthCorrelator oneBitCorrelator_;
+    RunLengthCorrelator zeroBitCorrelator_;
+
+    SymbolClassifier secondClassifier_;
+    SymbolClassifier referenceClassifier_;
+
+    // Flywheel. Erasures are filled in from the previous minute's
+    // time code plus one minute.
+    int erasedSeconds_;
+    char lastTimeCode_[TIMECODE_LENGTH];
+    bool haveLastTimeCode_;
+
+    // Soft 1/0 decisions for every second of the current minute, and
+    // the last few minutes of them for when no minute decodes alone.
+    TimeCodeAccumulator::SoftFrame timeCodeSoft_;
+    TimeCodeAccumulator accumulator_;
+
+    // On-time marker timestamping. Ticks are found on the input
+    // (before decimation) and matched up with the seconds the state
+    // machine decodes. Once the minute is known, a line fitted
+    // through them gives the input sample at which the minute
+    // began, which the clock model turns into host time.
+    TickDetector tickDetector_;
+    ClockModel clockModel_;
+    FixedRing<DetectedTick, 16> recentTicks_;
+    FixedRing<SecondTick, 128> minuteTicks_;
+
+    // Block processing buffers. The last two are only used to
+    // convert to and from float for fixed point DspSamples.
+    // gated_ and gatedSoft_ belong to decode().
+    DspSample blocked_[CarrierBlock::MAX_SAMPLES];
+    float decimated_[CarrierBlock::MAX_SAMPLES];
+    float scratch_[CarrierBlock::MAX_SAMPLES];
+    short filtered_[CarrierBlock::MAX_SAMPLES];
+    float floatBlocked_[CarrierBlock::MAX_SAMPLES];
+    DspSample dspDecimated_[CarrierBlock::MAX_SAMPLES];
+    bool gated_[CarrierBlock::MAX_SAMPLES];
+    float gatedSoft_[CarrierBlock::MAX_SAMPLES];
+    CarrierBlock block_;
+
+    bool reference_marker_seen();
+    bool pulse_after_marker(size_t markerStart) const;
+    void process_incoming_sample(bool carrierPresent, float soft);
+    void consume_samples(size_t count);
+    void clear_samples();
+    void match_tick(uint64_t carrierStart);
+    bool next_symbol(char symbol, const SymbolDecision& decision, size_t length, float softBit = 0);
+    void lose_sync(const char* lostDuring);
+    void emit_event(DecoderEvent::Kind kind, uint64_t carrierSample, char symbol = 0, const char* lostDuring = nullptr);
+    void count_event(DecoderEvent::Kind kind, char symbol, const char* lostDuring);
+    void lap(DecoderMetrics::Stage stage, uint64_t& since);
+    void parse_time_code();
+    void report_on_time_marker(DecodedMinute& minute);
+    size_t fit_ticks(Station station, double& secondZero, double& samplesPerSecond, double& jitter);
+    void finish_time_code();
+    bool run_state_machine();
+    size_t samples_until_decode() const;
+
+    void dc_block_stage(const int16_t* in, DspSample* out, size_t count);
+    void tick_stage(const DspSample* in, size_t count, CarrierBlock& block);
+    void bandpass_stage(const DspSample* in, short* out, float* scratch, size_t count);
+    void agc_stage(short* samples, size_t count);
+    void envelope_stage(const short* in, float* envelope, float* noiseLevel, size_t count);
+    void noise_gate_stage(const float* envelope, const bool* compareWith, bool* carrierPresent, float* soft, size_t count);
+    void quadrature_stage(const float* in, bool* carrierPresent, float* soft, size_t count);
+    bool carrier_stage(const bool* carrierPresent, const float* soft, size_t count);
+};
+
+#endif // _DECODER_H
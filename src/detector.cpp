@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cmath>
+
+#include "detector.h"
+
+namespace
+{
+
+// How quickly the peak and floor trackers forget, in seconds.
+const double TRACKER_TIME_CONSTANT = 3.0;
+
+// Hysteresis around the threshold, as a fraction of peak - floor.
+const float HYSTERESIS = 0.1f;
+
+// How long a new decision has to hold before it's taken, in
+// seconds. Until the trackers have seen the carrier, peak and
+// floor are both near zero and the decision follows the noise.
+const double MIN_DWELL = 0.005;
+
+}
+
+QuadratureDetector::QuadratureDetector(int sampleRate, double frequency, double windowSeconds)
+    : windowSize_(lround(sampleRate * windowSeconds))
+    , phase_(0)
+    , cosTable_(windowSize_)
+    , sinTable_(windowSize_)
+    , inPhaseProducts_(windowSize_, 0.0f)
+    , quadratureProducts_(windowSize_, 0.0f)
+    , inPhaseSum_(0)
+    , quadratureSum_(0)
+    , peakDecay_(exp(-1.0 / (TRACKER_TIME_CONSTANT * sampleRate)))
+    , floorRise_(1 - exp(-1.0 / (TRACKER_TIME_CONSTANT * sampleRate)))
+    , peak_(0)
+    , floor_(0)
+    , magnitude_(0)
+    , soft_(0)
+    , state_(false)
+    , minDwell_(lround(sampleRate * MIN_DWELL))
+    , dwell_(0)
+{
+    // The window holds a whole number of cycles, so the oscillator 
+    // phase repeats every window and can come from a table. The 2/N
+    // scale makes magnitude() the amplitude of the carrier.
+    for (size_t i = 0; i < windowSize_; i++)
+    {
+        double angle = 2 * M_PI * frequency * i / sampleRate;
+        cosTable_[i] = 2 * cos(angle) / windowSize_;
+        sinTable_[i] = 2 * sin(angle) / windowSize_;
+    }
+}
+
+bool QuadratureDetector::operator()(float sample)
+{
+    float inPhase = sample * cosTable_[phase_];
+    float quadrature = sample * sinTable_[phase_];
+    
+    inPhaseSum_ += inPhase - inPhaseProducts_[phase_];
+    quadratureSum_ += quadrature - quadratureProducts_[phase_];
+    inPhaseProducts_[phase_] = inPhase;
+    quadratureProducts_[phase_] = quadrature;
+    
+    if (++phase_ == windowSize_) phase_ = 0;
+    
+    magnitude_ = sqrt(inPhaseSum_ * inPhaseSum_ + quadratureSum_ * quadratureSum_);
+    
+    // Peak jumps up and decays slowly, floor drops immediately and 
+    // creeps back up. The carrier is on for 17-77% of every second
+    // so both get refreshed constantly while the station is heard.
+    peak_ = std::max(magnitude_, peak_ * peakDecay_);
+    floor_ = magnitude_ < floor_ ? magnitude_ : floor_ + (magnitude_ - floor_) * floorRise_;
+    
+    float range = peak_ - floor_;
+    float threshold = floor_ + 0.5f * range;
+    soft_ = range > 0 ? (magnitude_ - threshold) / range : 0;
+    
+    bool other = state_ ? soft_ < -HYSTERESIS : soft_ > HYSTERESIS;
+    if (!other) dwell_ = 0;
+    else if (++dwell_ >= minDwell_)
+    {
+        state_ = !state_;
+        dwell_ = 0;
+    }
+    
+    return state_;
+}
@@ -0,0 +1,62 @@
+#ifndef _DETECTOR_H
+#define _DETECTOR_H
+
+#include <cstddef>
+#include <vector>
+
+//=========================================================
+// 100 Hz subcarrier detector based on an I/Q mixer. The 
+// input is multiplied by a cosine/sine at exactly the 
+// subcarrier frequency and both products are summed over
+// a sliding window of a whole number of cycles (50ms by
+// default, i.e. five). Such a window has nulls every 20 Hz
+// away from the subcarrier, which covers the 440/500/600 Hz
+// tones and the 1000/1200 Hz ticks, so no bandpass filter
+// or AGC is needed in front of it. A one-cycle window only
+// nulls multiples of 100 Hz and lets enough of the 440 Hz
+// tone through to flip the decision at the beat frequency.
+//
+// Carrier presence is decided against a threshold halfway
+// between slow-moving peak and floor trackers, so it's
+// independent of signal level. A new decision has to hold
+// for a few milliseconds before it's taken.
+//=========================================================
+class QuadratureDetector
+{
+public:
+    QuadratureDetector(int sampleRate, double frequency = 100, double windowSeconds = 0.05);
+    
+    // Returns true if the carrier is present as of this sample.
+    bool operator()(float sample);
+    
+    // Carrier amplitude as of the last sample.
+    float magnitude() const { return magnitude_; }
+    
+    // Distance of the last magnitude from the decision threshold,
+    // normalized to the current peak-to-floor range (roughly -0.5 
+    // for silence to +0.5 for full carrier).
+    float soft() const { return soft_; }
+    
+private:
+    size_t windowSize_;
+    size_t phase_;
+    
+    std::vector<float> cosTable_;
+    std::vector<float> sinTable_;
+    std::vector<float> inPhaseProducts_;
+    std::vector<float> quadratureProducts_;
+    double inPhaseSum_;
+    double quadratureSum_;
+    
+    float peakDecay_;
+    float floorRise_;
+    float peak_;
+    float floor_;
+    float magnitude_;
+    float soft_;
+    bool state_;
+    size_t minDwell_;
+    size_t dwell_; // samples the other decision has held
+};
+
+#endif // _DETECTOR_H
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "dsp.h"
+
+using namespace cycfi::q::literals;
+
+EnvelopeDsp<float>::EnvelopeDsp(Filter& bandpassDesign, bool fastConvolution, int inputRate, int sampleRate)
+    : dcBlocker_(60_Hz, inputRate)
+    , agc_(1, sampleRate)
+    , agcSkip_(0)
+    , follower_(2_ms, sampleRate)
+    , noiseAvg_(200_ms, sampleRate)
+{
+    if (fastConvolution)
+    {
+        fastBandpass_ = std::make_unique<FastConvFilter>(bandpassDesign);
+        agcSkip_ = fastBandpass_->block_size();
+    }
+    else
+    {
+        directBandpass_ = std::make_unique<FirFilter>(bandpassDesign);
+    }
+}
+
+void EnvelopeDsp<float>::dc_block(const int16_t* in, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float blockedAudio = dcBlocker_((double)in[i] / SHRT_MAX);
+        out[i] = blockedAudio * SHRT_MAX;
+    }
+}
+
+void EnvelopeDsp<float>::bandpass(const float* in, short* out, float* scratch, size_t count)
+{
+    if (fastBandpass_) fastBandpass_->process(in, scratch, count);
+    else directBandpass_->process(in, scratch, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = (short)scratch[i];
+    }
+}
+
+// The AGC's windows start at its first sample. The zeros fast
+// convolution puts out for its first block are left out of them,
+// so they line up with the signal as they would with direct form.
+void EnvelopeDsp<float>::agc(short* samples, size_t count)
+{
+    size_t skip = std::min(count, agcSkip_);
+    agcSkip_ -= skip;
+    agc_.process(samples + skip, count - skip);
+}
+
+void EnvelopeDsp<float>::envelope(const short* in, float* envelope, float* noiseLevel, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        auto floatSample = (float)in[i] / SHRT_MAX;
+        envelope[i] = follower_(floatSample);
+
+        // Adjust moving average. Don't adjust thresholds yet.
+        // That will be done whenever we have enough samples to
+        // attempt a symbol decode.
+        noiseAvg_(envelope[i]);
+        noiseLevel[i] = noiseAvg_();
+    }
+}
+
+// Same time constants as the float version.
+EnvelopeDsp<int16_t>::EnvelopeDsp(Filter& bandpassDesign, bool /* fastConvolution */, int inputRate, int sampleRate)
+    : dcBlocker_(60, inputRate)
+    , bandpass_(bandpassDesign)
+    , agc_(1, sampleRate)
+    , follower_(0.002, 0.2, sampleRate)
+{
+    // Nothing else to do.
+}
+
+const float* toFloatSamples(const int16_t* in, float* scratch, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        scratch[i] = in[i];
+    }
+    return scratch;
+}
+
+const int16_t* fromFloatSamples(const float* in, int16_t* scratch, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        scratch[i] = saturate16(lrintf(in[i]));
+    }
+    return scratch;
+}
@@ -0,0 +1,94 @@
+#ifndef _DSP_H
+#define _DSP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <q/fx/envelope.hpp>
+#include <q/fx/dc_block.hpp>
+#include <q/fx/moving_average.hpp>
+
+#include "filt.h"
+#include "agc.h"
+#include "fir.h"
+#include "fastconv.h"
+#include "fixedpoint.h"
+
+//=========================================================
+// The per-sample DSP of the envelope detector: DC blocker
+// (on the input, ahead of the tick detector), then bandpass
+// filter, AGC and envelope follower with its noise level.
+// Sample is the type between the DC blocker and the bandpass
+// filter: float, with the q library's building blocks, or
+// int16_t for all-integer Q15 versions of them (see
+// fixedpoint.h). Both keep audio at full scale = SHRT_MAX and
+// hand short samples from the bandpass filter to the AGC, and
+// the envelope and noise level come out as float for the
+// noise gate either way.
+//=========================================================
+template <typename Sample>
+class EnvelopeDsp;
+
+template <>
+class EnvelopeDsp<float>
+{
+public:
+    // With fastConvolution, the bandpass is a FastConvFilter.
+    EnvelopeDsp(Filter& bandpassDesign, bool fastConvolution, int inputRate, int sampleRate);
+
+    void dc_block(const int16_t* in, float* out, size_t count);
+    void bandpass(const float* in, short* out, float* scratch, size_t count);
+    void agc(short* samples, size_t count);
+    void envelope(const short* in, float* envelope, float* noiseLevel, size_t count);
+
+    double agc_gain_db() const { return agc_.gain_db(); }
+
+    // Samples the bandpass filter's output lags behind on top of
+    // its group delay (a block, with fast convolution).
+    size_t bandpass_latency() const { return fastBandpass_ ? fastBandpass_->block_size() : 0; }
+
+private:
+    cycfi::q::dc_block dcBlocker_;
+    std::unique_ptr<FirFilter> directBandpass_;
+    std::unique_ptr<FastConvFilter> fastBandpass_;
+    BlockAgc agc_;
+    size_t agcSkip_; // samples of fast convolution's startup left
+    cycfi::q::fast_ave_envelope_follower follower_;
+    cycfi::q::moving_average noiseAvg_;
+};
+
+template <>
+class EnvelopeDsp<int16_t>
+{
+public:
+    // The bandpass filter is always direct form (fastConvolution
+    // is ignored), as fast convolution needs floating point FFTs.
+    EnvelopeDsp(Filter& bandpassDesign, bool fastConvolution, int inputRate, int sampleRate);
+
+    void dc_block(const int16_t* in, int16_t* out, size_t count) { dcBlocker_.process(in, out, count); }
+    void bandpass(const int16_t* in, short* out, float* /* scratch */, size_t count) { bandpass_.process(in, out, count); }
+    void agc(short* samples, size_t count) { agc_.process(samples, count); }
+    void envelope(const short* in, float* envelope, float* noiseLevel, size_t count) { follower_.process(in, envelope, noiseLevel, count); }
+
+    double agc_gain_db() const { return agc_.gain_db(); }
+    size_t bandpass_latency() const { return 0; }
+
+private:
+    FixedDcBlocker dcBlocker_;
+    FixedFirFilter bandpass_;
+    FixedAgc agc_;
+    FixedEnvelopeFollower follower_;
+};
+
+// The tick detector, decimator and quadrature detector work in
+// float whatever the envelope detector's sample type. These pass
+// float samples through as they are and convert Q15 ones into
+// scratch, both ways.
+inline const float* toFloatSamples(const float* in, float* /* scratch */, size_t /* count */) { return in; }
+const float* toFloatSamples(const int16_t* in, float* scratch, size_t count);
+
+inline const float* fromFloatSamples(const float* in, float* /* scratch */, size_t /* count */) { return in; }
+const int16_t* fromFloatSamples(const float* in, int16_t* scratch, size_t count);
+
+#endif // _DSP_H
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "fastconv.h"
+
+namespace
+{
+
+size_t fftSizeFor(int numTaps)
+{
+    // At least four times the filter length so that most of every
+    // transform is new output.
+    size_t n = 64;
+    while (n < 4 * (size_t)numTaps) n <<= 1;
+    return n;
+}
+
+// Plain complex multiply; std::complex's operator* goes through a
+// library call to get inf/NaN handling right, which we don't need.
+inline std::complex<float> mul(std::complex<float> a, std::complex<float> b)
+{
+    return std::complex<float>(
+        a.real() * b.real() - a.imag() * b.imag(),
+        a.real() * b.imag() + a.imag() * b.real());
+}
+
+}
+
+RealFft::RealFft(size_t n)
+    : n_(n)
+    , bitReverse_(n / 2)
+    , twiddles_(n / 4)
+    , splitTwiddles_(n / 2 + 1)
+    , work_(n / 2)
+{
+    size_t half = n_ / 2;
+    
+    int bits = 0;
+    while (((size_t)1 << bits) < half) bits++;
+    for (size_t i = 0; i < half; i++)
+    {
+        size_t reversed = 0;
+        for (int b = 0; b < bits; b++)
+        {
+            if (i & ((size_t)1 << b)) reversed |= (size_t)1 << (bits - 1 - b);
+        }
+        bitReverse_[i] = reversed;
+    }
+    
+    for (size_t k = 0; k < twiddles_.size(); k++)
+    {
+        double angle = -2 * M_PI * k / half;
+        twiddles_[k] = std::complex<float>(cos(angle), sin(angle));
+    }
+    
+    for (size_t k = 0; k < splitTwiddles_.size(); k++)
+    {
+        double angle = -2 * M_PI * k / n_;
+        splitTwiddles_[k] = std::complex<float>(cos(angle), sin(angle));
+    }
+}
+
+void RealFft::fft(std::complex<float>* data, bool inverse)
+{
+    size_t half = n_ / 2;
+    
+    for (size_t i = 0; i < half; i++)
+    {
+        size_t j = bitReverse_[i];
+        if (i < j) std::swap(data[i], data[j]);
+    }
+    
+    for (size_t len = 2; len <= half; len <<= 1)
+    {
+        size_t step = half / len;
+        for (size_t start = 0; start < half; start += len)
+        {
+            for (size_t k = 0; k < len / 2; k++)
+            {
+                std::complex<float> w = twiddles_[k * step];
+                if (inverse) w = std::conj(w);
+                
+                std::complex<float> even = data[start + k];
+                std::complex<float> odd = mul(data[start + k + len / 2], w);
+                data[start + k] = even + odd;
+                data[start + k + len / 2] = even - odd;
+            }
+        }
+    }
+}
+
+void RealFft::forward(const float* in, std::complex<float>* out)
+{
+    size_t half = n_ / 2;
+    
+    for (size_t i = 0; i < half; i++)
+    {
+        work_[i] = std::complex<float>(in[2 * i], in[2 * i + 1]);
+    }
+    fft(work_.data(), false);
+    
+    // Separate the transforms of the even and odd samples, then 
+    // combine them into the first half of the full spectrum.
+    for (size_t k = 0; k <= half; k++)
+    {
+        std::complex<float> z = work_[k % half];
+        std::complex<float> zMirror = std::conj(work_[(half - k) % half]);
+        
+        std::complex<float> even = 0.5f * (z + zMirror);
+        std::complex<float> diff = z - zMirror;
+        std::complex<float> odd(0.5f * diff.imag(), -0.5f * diff.real());
+        out[k] = even + mul(splitTwiddles_[k], odd);
+    }
+}
+
+void RealFft::inverse(const std::complex<float>* in, float* out)
+{
+    size_t half = n_ / 2;
+    
+    for (size_t k = 0; k < half; k++)
+    {
+        std::complex<float> x = in[k];
+        std::complex<float> xMirror = std::conj(in[half - k]);
+        
+        std::complex<float> even = 0.5f * (x + xMirror);
+        std::complex<float> odd = mul(0.5f * (x - xMirror), std::conj(splitTwiddles_[k]));
+        work_[k] = even + std::complex<float>(-odd.imag(), odd.real());
+    }
+    fft(work_.data(), true);
+    
+    float scale = 1.0f / half;
+    for (size_t i = 0; i < half; i++)
+    {
+        out[2 * i] = work_[i].real() * scale;
+        out[2 * i + 1] = work_[i].imag() * scale;
+    }
+}
+
+FastConvFilter::FastConvFilter(Filter& design)
+    : numTaps_(design.get_error_flag() == 0 ? design.get_num_taps() : 1)
+    , blockSize_(fftSizeFor(numTaps_) - numTaps_ + 1)
+    , fill_(0)
+    , fft_(fftSizeFor(numTaps_))
+    , response_(fft_.size() / 2 + 1)
+    , spectrum_(fft_.size() / 2 + 1)
+    , input_(fft_.size())
+    , output_(blockSize_)
+    , scratch_(fft_.size())
+{
+    // A failed design turns into a filter that outputs silence, 
+    // same as Filter::do_sample().
+    std::vector<double> taps(numTaps_, 0.0);
+    if (design.get_error_flag() == 0) design.get_taps(taps.data());
+    
+    std::fill(scratch_.begin(), scratch_.end(), 0.0f);
+    std::copy(taps.begin(), taps.end(), scratch_.begin());
+    fft_.forward(scratch_.data(), response_.data());
+    
+    init();
+}
+
+void FastConvFilter::init()
+{
+    std::fill(input_.begin(), input_.end(), 0.0f);
+    std::fill(output_.begin(), output_.end(), 0.0f);
+    fill_ = 0;
+}
+
+void FastConvFilter::runBlock()
+{
+    fft_.forward(input_.data(), spectrum_.data());
+    for (size_t k = 0; k < spectrum_.size(); k++)
+    {
+        spectrum_[k] = mul(spectrum_[k], response_[k]);
+    }
+    fft_.inverse(spectrum_.data(), scratch_.data());
+    
+    // The first num_taps - 1 results wrapped around and are discarded.
+    memcpy(output_.data(), scratch_.data() + numTaps_ - 1, blockSize_ * sizeof(float));
+    
+    // Keep the tail of this block as history for the next one.
+    memmove(input_.data(), input_.data() + blockSize_, (numTaps_ - 1) * sizeof(float));
+    fill_ = 0;
+}
+
+float FastConvFilter::do_sample(float sample)
+{
+    input_[numTaps_ - 1 + fill_] = sample;
+    float result = output_[fill_];
+    
+    if (++fill_ == blockSize_) runBlock();
+    return result;
+}
+
+void FastConvFilter::process(const float* in, float* out, size_t count)
+{
+    while (count > 0)
+    {
+        size_t chunk = std::min(count, blockSize_ - fill_);
+        
+        memcpy(&input_[numTaps_ - 1 + fill_], in, chunk * sizeof(float));
+        memcpy(out, &output_[fill_], chunk * sizeof(float));
+        fill_ += chunk;
+        if (fill_ == blockSize_) runBlock();
+        
+        in += chunk;
+        out += chunk;
+        count -= chunk;
+    }
+}
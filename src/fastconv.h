@@ -0,0 +1,75 @@
+#ifndef _FASTCONV_H
+#define _FASTCONV_H
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "filt.h"
+
+//=========================================================
+// Radix-2 FFT of real input. A size n transform is done as
+// an n/2 point complex FFT of the even/odd samples packed
+// as real/imaginary parts, plus one split pass.
+//=========================================================
+class RealFft
+{
+public:
+    explicit RealFft(size_t n);
+    
+    size_t size() const { return n_; }
+    
+    // n real samples in, n/2 + 1 bins out.
+    void forward(const float* in, std::complex<float>* out);
+    
+    // n/2 + 1 bins in, n real samples out (scaled by 1/n).
+    void inverse(const std::complex<float>* in, float* out);
+    
+private:
+    void fft(std::complex<float>* data, bool inverse);
+    
+    size_t n_;
+    std::vector<size_t> bitReverse_;
+    std::vector<std::complex<float>> twiddles_;      // e^-2pi*i*k/(n/2), k < n/4
+    std::vector<std::complex<float>> splitTwiddles_; // e^-2pi*i*k/n, k <= n/2
+    std::vector<std::complex<float>> work_;
+};
+
+//=========================================================
+// Overlap-save fast convolution filter, a drop-in for
+// FirFilter when the number of taps gets large: cost per 
+// sample grows with log(taps) instead of linearly.
+//
+// Output is delayed by block_size() samples on top of the
+// filter's own group delay since a block of output can only
+// be computed once a full block of input has arrived.
+//=========================================================
+class FastConvFilter
+{
+public:
+    // Takes the taps designed by an existing Filter object.
+    FastConvFilter(Filter& design);
+    
+    void init();
+    float do_sample(float sample);
+    void process(const float* in, float* out, size_t count);
+    
+    int num_taps() const { return numTaps_; }
+    size_t block_size() const { return blockSize_; }
+    
+private:
+    void runBlock();
+    
+    int numTaps_;
+    size_t blockSize_;   // new samples per FFT
+    size_t fill_;        // samples buffered in the current block
+    
+    RealFft fft_;
+    std::vector<std::complex<float>> response_;  // FFT of the taps
+    std::vector<std::complex<float>> spectrum_;
+    std::vector<float> input_;   // num_taps - 1 old samples + current block
+    std::vector<float> output_;  // previous block's results
+    std::vector<float> scratch_;
+};
+
+#endif // _FASTCONV_H
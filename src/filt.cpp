@@ -44,6 +44,7 @@
 Filter::Filter(filterType filt_t, int num_taps, double Fs, double Fx)
 {
 	m_error_flag = 0;
+	m_taps = m_sr = NULL;
 	m_filt_t = filt_t;
 	m_num_taps = num_taps;
 	m_Fs = Fs;
@@ -54,7 +55,6 @@ Filter::Filter(filterType filt_t, int num_taps, double Fs, double Fx)
 	if( Fx <= 0 || Fx >= Fs/2 ) ECODE(-2);
 	if( m_num_taps <= 0 || m_num_taps > MAX_NUM_FILTER_TAPS ) ECODE(-3);
 
-	m_taps = m_sr = NULL;
 	m_taps = (double*)malloc( m_num_taps * sizeof(double) );
 	m_sr = (double*)malloc( m_num_taps * sizeof(double) );
 	if( m_taps == NULL || m_sr == NULL ) ECODE(-4);
@@ -73,6 +73,7 @@ Filter::Filter(filterType filt_t, int num_taps, double Fs, double Fl,
                double Fu)
 {
 	m_error_flag = 0;
+	m_taps = m_sr = NULL;
 	m_filt_t = filt_t;
 	m_num_taps = num_taps;
 	m_Fs = Fs;
@@ -87,7 +88,6 @@ Filter::Filter(filterType filt_t, int num_taps, double Fs, double Fl,
 	if( Fu <= 0 || Fu >= Fs/2 ) ECODE(-13);
 	if( m_num_taps <= 0 || m_num_taps > MAX_NUM_FILTER_TAPS ) ECODE(-14);
 
-	m_taps = m_sr = NULL;
 	m_taps = (double*)malloc( m_num_taps * sizeof(double) );
 	m_sr = (double*)malloc( m_num_taps * sizeof(double) );
 	if( m_taps == NULL || m_sr == NULL ) ECODE(-15);
@@ -152,6 +152,20 @@ Filter::designBPF()
 	return;
 }
 
+void 
+Filter::hamming_window()
+{
+	int n;
+
+	if( m_error_flag != 0 || m_num_taps < 2 ) return;
+
+	for(n = 0; n < m_num_taps; n++){
+		m_taps[n] *= 0.54 - 0.46 * cos( 2.0 * M_PI * n / (m_num_taps - 1.0) );
+	}
+
+	return;
+}
+
 void 
 Filter::get_taps( double *taps )
 {
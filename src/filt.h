@@ -113,12 +113,14 @@
  * frequency response of an ideal filter (LPF, HPF, BPF) are used as
  * the filter taps.  The resulting filters have some ripple in the passband 
  * due to the Gibbs phenomenon; the filters are linear phase.
+ * hamming_window() tapers the taps afterwards, which trades a wider
+ * transition band for stopband sidelobes around -40 dB instead of -20 dB.
  */
 
 #ifndef _FILTER_H
 #define _FILTER_H
 
-#define MAX_NUM_FILTER_TAPS 1000
+#define MAX_NUM_FILTER_TAPS 16384
 
 #include <stdio.h>
 #include <math.h>
@@ -151,8 +153,10 @@ class Filter{
 		Filter(filterType filt_t, int num_taps, double Fs, double Fl, double Fu);
 		~Filter( );
 		void init();
+		void hamming_window();
 		double do_sample(double data_sample);
 		int get_error_flag(){return m_error_flag;};
+		int get_num_taps(){return m_num_taps;};
 		void get_taps( double *taps );
 		int write_taps_to_file( char* filename );
 		int write_freqres_to_file( char* filename );
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "fir.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FIR_HAVE_X86 1
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FIR_HAVE_NEON 1
+#endif
+
+namespace
+{
+
+float dotScalar(const float* x, const float* h, int n)
+{
+    // Four independent accumulators so the compiler doesn't serialize
+    // on a single add chain.
+    float acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        acc0 += x[i] * h[i];
+        acc1 += x[i + 1] * h[i + 1];
+        acc2 += x[i + 2] * h[i + 2];
+        acc3 += x[i + 3] * h[i + 3];
+    }
+    for (; i < n; i++)
+    {
+        acc0 += x[i] * h[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+#if defined(FIR_HAVE_X86)
+__attribute__((target("sse2")))
+float dotSse(const float* x, const float* h, int n)
+{
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(h + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc0);
+    float result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++)
+    {
+        result += x[i] * h[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx,fma")))
+float dotAvx(const float* x, const float* h, int n)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(h + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(h + i + 8), acc1);
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    float result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++)
+    {
+        result += x[i] * h[i];
+    }
+    return result;
+}
+#endif // FIR_HAVE_X86
+
+#if defined(FIR_HAVE_NEON)
+float dotNeon(const float* x, const float* h, int n)
+{
+    float32x4_t acc0 = vdupq_n_f32(0);
+    float32x4_t acc1 = vdupq_n_f32(0);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(x + i), vld1q_f32(h + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(x + i + 4), vld1q_f32(h + i + 4));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    
+    float lanes[4];
+    vst1q_f32(lanes, acc0);
+    float result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++)
+    {
+        result += x[i] * h[i];
+    }
+    return result;
+}
+#endif // FIR_HAVE_NEON
+
+}
+
+std::vector<NamedDotKernel> supportedDotKernels()
+{
+    std::vector<NamedDotKernel> kernels = {{"scalar", dotScalar}};
+    
+#if defined(FIR_HAVE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        kernels.push_back({"sse", dotSse});
+    }
+    if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma"))
+    {
+        kernels.push_back({"avx", dotAvx});
+    }
+#elif defined(FIR_HAVE_NEON)
+    kernels.push_back({"neon", dotNeon});
+#endif
+    
+    return kernels;
+}
+
+DotKernel bestDotKernel(const char** name)
+{
+    NamedDotKernel best = supportedDotKernels().back();
+    if (name != nullptr) *name = best.name;
+    return best.kernel;
+}
+
+void enableFlushToZero()
+{
+#if defined(FIR_HAVE_X86)
+    // FTZ (bit 15) and DAZ (bit 6) in MXCSR.
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+#elif defined(__aarch64__)
+    // FZ (bit 24) in FPCR.
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (1 << 24)));
+#endif
+}
+
+FirFilter::FirFilter(Filter& design)
+    : numTaps_(0)
+    , pos_(0)
+{
+    if (design.get_error_flag() == 0)
+    {
+        numTaps_ = design.get_num_taps();
+        
+        std::vector<double> taps(numTaps_);
+        design.get_taps(taps.data());
+        taps_.assign(taps.begin(), taps.end());
+    }
+    
+    history_.resize(2 * numTaps_);
+    init();
+    
+    kernel_ = bestDotKernel(&kernelName_);
+}
+
+void FirFilter::use_kernel(const NamedDotKernel& kernel)
+{
+    kernel_ = kernel.kernel;
+    kernelName_ = kernel.name;
+}
+
+void FirFilter::init()
+{
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    pos_ = 0;
+}
+
+float FirFilter::do_sample(float sample)
+{
+    if (numTaps_ == 0) return 0;
+    
+    // Newest sample lives at pos_, oldest at pos_ + numTaps_ - 1, 
+    // same ordering as Filter's shift register.
+    pos_ = (pos_ == 0) ? numTaps_ - 1 : pos_ - 1;
+    history_[pos_] = sample;
+    history_[pos_ + numTaps_] = sample;
+    
+    return kernel_(&history_[pos_], taps_.data(), numTaps_);
+}
+
+void FirFilter::process(const float* in, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = do_sample(in[i]);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef _FIR_H
+#define _FIR_H
+
+#include <cstddef>
+#include <vector>
+
+#include "filt.h"
+
+// Dot product of n floats, implemented with the best kernel
+// available on the running CPU (AVX, SSE or NEON), falling 
+// back to plain C++ otherwise.
+typedef float (*DotKernel)(const float* x, const float* h, int n);
+DotKernel bestDotKernel(const char** name = nullptr);
+
+// Every kernel the running CPU supports, best last.
+struct NamedDotKernel
+{
+    const char* name;
+    DotKernel kernel;
+};
+std::vector<NamedDotKernel> supportedDotKernels();
+
+// Makes the calling thread flush denormal floats to zero. Long
+// filters ringing down into silence otherwise spend most of their
+// time in microcode assists on x86.
+void enableFlushToZero();
+
+//=========================================================
+// Direct-form FIR engine used for the long bandpass filter.
+//
+// The history is stored twice back to back so that the most
+// recent num_taps samples are always contiguous in memory:
+// each new sample is written at pos and pos + num_taps and
+// the dot product runs over [pos, pos + num_taps) without
+// shifting anything. The dot product itself is done in float
+// using bestDotKernel().
+//=========================================================
+class FirFilter
+{
+public:
+    // Takes the taps designed by an existing Filter object.
+    FirFilter(Filter& design);
+
+    void init();
+    float do_sample(float sample);
+    void process(const float* in, float* out, size_t count);
+
+    int num_taps() const { return numTaps_; }
+    const char* kernel_name() const { return kernelName_; }
+
+    // Overrides the choice of bestDotKernel(), e.g. to compare them.
+    void use_kernel(const NamedDotKernel& kernel);
+
+private:
+    int numTaps_;
+    int pos_;
+    std::vector<float> taps_;
+    std::vector<float> history_;
+    DotKernel kernel_;
+    const char* kernelName_;
+};
+
+#endif // _FIR_H
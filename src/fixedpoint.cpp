@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "fixedpoint.h"
+
+namespace
+{
+
+// Each product fits in 32 bits, but a sum of two of them can
+// already overflow (-32768 * -32768 * 2), so they're summed in
+// 64 bits.
+int64_t dotScalar(const int16_t* x, const int16_t* h, int n)
+{
+    int64_t acc0 = 0, acc1 = 0;
+    int i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        acc0 += (int32_t)x[i] * h[i];
+        acc1 += (int32_t)x[i + 1] * h[i + 1];
+    }
+    for (; i < n; i++)
+    {
+        acc0 += (int32_t)x[i] * h[i];
+    }
+    return acc0 + acc1;
+}
+
+// -6 dB of full scale, in Q16.
+const int64_t AGC_TARGET = (int64_t)(0.5011872336272722 * SHRT_MAX * 65536 + 0.5);
+
+// Extra fraction bits of the envelope follower's state.
+const int ENVELOPE_SHIFT = 8;
+
+}
+
+FixedDcBlocker::FixedDcBlocker(double cutoff, double sampleRate)
+    : pole_((int32_t)lround(exp(-2 * M_PI * cutoff / sampleRate) * (1 << 30)))
+    , x_(0)
+    , y_(0)
+{
+    // Nothing else to do.
+}
+
+void FixedDcBlocker::process(const int16_t* in, int16_t* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        int32_t x = in[i];
+        int64_t y = ((int64_t)(x - x_) << 8) + (((int64_t)pole_ * y_ + (1 << 29)) >> 30);
+        x_ = x;
+        y_ = (int32_t)y;
+        out[i] = saturate16((y + 128) >> 8);
+    }
+}
+
+FixedFirFilter::FixedFirFilter(Filter& design)
+    : numTaps_(0)
+    , pos_(0)
+    , shift_(15)
+{
+    if (design.get_error_flag() == 0)
+    {
+        numTaps_ = design.get_num_taps();
+
+        std::vector<double> taps(numTaps_);
+        design.get_taps(taps.data());
+
+        double largest = 0;
+        for (double tap : taps)
+        {
+            largest = std::max(largest, fabs(tap));
+        }
+        while (shift_ > 0 && largest * ldexp(1.0, shift_) >= INT16_MAX)
+        {
+            shift_--;
+        }
+        while (shift_ < 30 && largest * ldexp(1.0, shift_ + 1) < INT16_MAX)
+        {
+            shift_++;
+        }
+
+        for (double tap : taps)
+        {
+            taps_.push_back((int16_t)lround(ldexp(tap, shift_)));
+        }
+    }
+
+    history_.resize(2 * numTaps_);
+}
+
+void FixedFirFilter::process(const int16_t* in, int16_t* out, size_t count)
+{
+    if (numTaps_ == 0)
+    {
+        std::fill(out, out + count, 0);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        // Same ordering as FirFilter: newest sample at pos_.
+        pos_ = (pos_ == 0) ? numTaps_ - 1 : pos_ - 1;
+        history_[pos_] = in[i];
+        history_[pos_ + numTaps_] = in[i];
+
+        int64_t sum = dotScalar(&history_[pos_], taps_.data(), numTaps_);
+        out[i] = saturate16(sum >= 0 ? sum >> shift_ : -(-sum >> shift_));
+    }
+}
+
+FixedAgc::FixedAgc(double holdSeconds, double sampleRate)
+    : halfWindow_(std::max(1, (int)(holdSeconds * sampleRate / 2)))
+    , pos_(0)
+    , current_(0)
+    , previous_(0)
+    , peak_(0)
+    , gain_(AGC_TARGET)
+{
+    // Nothing else to do.
+}
+
+void FixedAgc::process(int16_t* samples, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        int32_t magnitude = std::abs((int32_t)samples[i]);
+        current_ = std::max(current_, magnitude);
+        if (++pos_ >= halfWindow_)
+        {
+            previous_ = current_;
+            current_ = 0;
+            pos_ = 0;
+        }
+
+        int32_t peak = std::max(previous_, current_);
+        if (peak != peak_)
+        {
+            peak_ = peak;
+            gain_ = AGC_TARGET / std::max(peak, 1);
+        }
+
+        // The peak includes this sample, so this can't exceed -6 dB.
+        samples[i] = saturate16(samples[i] * gain_ / 65536);
+    }
+}
+
+double FixedAgc::gain_db() const
+{
+    return 20 * log10(gain_ / 65536.0);
+}
+
+FixedEnvelopeFollower::FixedEnvelopeFollower(double holdSeconds, double averageSeconds, double sampleRate)
+    : hold_(std::max(1, (int)(holdSeconds * sampleRate)))
+    , pos_(0)
+    , peak_(0)
+    , envelope_(0)
+    , average_(std::max<size_t>(1, (size_t)(averageSeconds * sampleRate)), 0)
+    , averagePos_(0)
+    , averageSum_(0)
+{
+    // Nothing else to do.
+}
+
+void FixedEnvelopeFollower::process(const int16_t* in, float* envelope, float* noiseLevel, size_t count)
+{
+    const float envelopeScale = 1.0f / ((float)SHRT_MAX * (1 << ENVELOPE_SHIFT));
+    const float averageScale = envelopeScale / average_.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        peak_ = std::max(peak_, std::abs((int32_t)in[i]));
+        if (++pos_ >= hold_)
+        {
+            envelope_ = (envelope_ + (peak_ << ENVELOPE_SHIFT)) >> 1;
+            peak_ = 0;
+            pos_ = 0;
+        }
+
+        averageSum_ += envelope_ - average_[averagePos_];
+        average_[averagePos_] = envelope_;
+        averagePos_ = averagePos_ + 1 == average_.size() ? 0 : averagePos_ + 1;
+
+        envelope[i] = envelope_ * envelopeScale;
+        noiseLevel[i] = averageSum_ * averageScale;
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef _FIXEDPOINT_H
+#define _FIXEDPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "filt.h"
+
+// Integer versions of the envelope detector's building blocks,
+// for CPUs without a fast FPU (see EnvelopeDsp<int16_t> in dsp.h).
+// Samples are Q15: int16_t with full scale at SHRT_MAX, the same
+// scale the float path keeps its audio at. Coefficients and state
+// carry extra fraction bits where rounding would otherwise add up.
+
+inline int16_t saturate16(int64_t value)
+{
+    return value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t)value;
+}
+
+//=========================================================
+// One pole DC blocker, y[n] = x[n] - x[n-1] + r * y[n-1],
+// with r in Q30 and y kept with 8 extra fraction bits.
+//=========================================================
+class FixedDcBlocker
+{
+public:
+    FixedDcBlocker(double cutoff, double sampleRate);
+
+    void process(const int16_t* in, int16_t* out, size_t count);
+
+private:
+    int32_t pole_; // Q30
+    int32_t x_;
+    int32_t y_;    // Q15 << 8
+};
+
+//=========================================================
+// Direct-form FIR in Q15 with a 64-bit accumulator, laid out
+// like FirFilter (doubled history, no shifting). The taps are
+// scaled up by a power of two so that the largest one uses
+// the full 16 bits, since a narrow bandpass has taps far
+// below 1, and the sum is scaled back down before it's
+// saturated to 16 bits. It's truncated toward zero rather
+// than rounded, as the float path's bandpass output is when
+// it's converted to short, so both see the same noise level.
+//=========================================================
+class FixedFirFilter
+{
+public:
+    // Takes the taps designed by an existing Filter object.
+    FixedFirFilter(Filter& design);
+
+    void process(const int16_t* in, int16_t* out, size_t count);
+
+    int num_taps() const { return numTaps_; }
+
+private:
+    int numTaps_;
+    int pos_;
+    int shift_; // taps are Q(15 + shift_)
+    std::vector<int16_t> taps_;
+    std::vector<int16_t> history_;
+};
+
+//=========================================================
+// Peak-hold AGC: follows the largest magnitude over two
+// alternating half windows of the given hold time, and
+// scales samples so that it comes out at -6 dB. The gain
+// (Q16) only needs a division when the peak changes, which
+// is a few times a second, instead of a log and an exp per
+// sample.
+//=========================================================
+class FixedAgc
+{
+public:
+    FixedAgc(double holdSeconds, double sampleRate);
+
+    void process(int16_t* samples, size_t count);
+
+    // Gain applied to the last sample, in dB.
+    double gain_db() const;
+
+private:
+    int halfWindow_;
+    int pos_;
+    int32_t current_;  // peak of the current half window
+    int32_t previous_; // and of the one before
+    int32_t peak_;     // that gain_ was computed for
+    int64_t gain_;     // Q16
+};
+
+//=========================================================
+// Envelope follower (the peak of each hold period, averaged
+// with the previous output) and the moving average of its
+// output that serves as the noise level. Both are kept in
+// Q15 << 8 and only converted to float on the way out,
+// since the noise gate after them is floating point.
+//=========================================================
+class FixedEnvelopeFollower
+{
+public:
+    FixedEnvelopeFollower(double holdSeconds, double averageSeconds, double sampleRate);
+
+    void process(const int16_t* in, float* envelope, float* noiseLevel, size_t count);
+
+private:
+    int hold_;
+    int pos_;
+    int32_t peak_;
+    int32_t envelope_;
+
+    std::vector<int32_t> average_;
+    size_t averagePos_;
+    int64_t averageSum_;
+};
+
+#endif // _FIXEDPOINT_H
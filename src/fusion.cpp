@@ -0,0 +1,197 @@
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include "fusion.h"
+
+MinuteFusion::MinuteFusion(const std::vector<std::string>& inputNames,
+                           std::vector<std::unique_ptr<RefclockDriver>>& refclocks,
+                           std::ostream* out)
+    : names_(inputNames)
+    , refclocks_(refclocks)
+    , out_(out)
+    , latestKey_(inputNames.size(), -HUGE_VAL)
+    , finished_(inputNames.size(), false)
+    , lastResolvedKey_(-HUGE_VAL)
+    , stopping_(false)
+{
+    timer_ = std::thread(&MinuteFusion::run_timer, this);
+}
+
+MinuteFusion::~MinuteFusion()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    timer_.join();
+
+    // Whatever is left can't get any more reports.
+    std::lock_guard<std::mutex> lock(mutex_);
+    resolve_ready(true);
+}
+
+double MinuteFusion::key_of(const DecodedMinute& minute)
+{
+    return minute.live ? minute.began : toUnixTime(minute.timeCode);
+}
+
+void MinuteFusion::add(size_t input, const DecodedMinute& minute)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    double key = key_of(minute);
+    latestKey_[input] = std::max(latestKey_[input], key);
+
+    if (key < lastResolvedKey_ + SAME_MINUTE)
+    {
+        // Too late, that minute has already been passed on.
+        resolve_ready(false);
+        return;
+    }
+
+    auto group = pending_.begin();
+    while (group != pending_.end() && group->key + SAME_MINUTE <= key)
+    {
+        group++;
+    }
+
+    if (group == pending_.end() || key + SAME_MINUTE <= group->key)
+    {
+        Group newGroup;
+        newGroup.key = key;
+        newGroup.live = minute.live;
+        newGroup.deadline = Clock::now() + MAX_WAIT;
+        group = pending_.insert(group, newGroup);
+        changed_.notify_all();
+    }
+
+    group->reports.push_back({input, minute});
+    resolve_ready(false);
+}
+
+void MinuteFusion::input_finished(size_t input)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_[input] = true;
+    resolve_ready(false);
+}
+
+bool MinuteFusion::ready(const Group& group, Clock::time_point now) const
+{
+    if (group.live && now >= group.deadline)
+    {
+        return true;
+    }
+
+    for (size_t input = 0; input < names_.size(); input++)
+    {
+        bool reported = false;
+        for (auto& report : group.reports)
+        {
+            reported |= report.input == input;
+        }
+
+        if (!reported && !finished_[input] && latestKey_[input] < group.key + SAME_MINUTE)
+        {
+            // Might still be working on this minute.
+            return false;
+        }
+    }
+    return true;
+}
+
+void MinuteFusion::resolve_ready(bool all)
+{
+    auto now = Clock::now();
+    while (!pending_.empty() && (all || ready(pending_.front(), now)))
+    {
+        resolve(pending_.front());
+        lastResolvedKey_ = pending_.front().key;
+        pending_.erase(pending_.begin());
+    }
+}
+
+void MinuteFusion::resolve(const Group& group)
+{
+    // Every report votes for the time it decoded, weighted by its
+    // tick-to-noise ratio (as an amplitude ratio, so that no ticks
+    // still counts for something).
+    std::map<time_t, float> votes;
+    for (auto& report : group.reports)
+    {
+        votes[toUnixTime(report.minute.timeCode)] += pow(10, report.minute.snr / 20);
+    }
+
+    auto winner = votes.begin();
+    for (auto vote = votes.begin(); vote != votes.end(); vote++)
+    {
+        if (vote->second > winner->second) winner = vote;
+    }
+
+    // Timestamp from the strongest report of the winning time,
+    // preferring those that have one at all.
+    const Report* best = nullptr;
+    size_t numAgreeing = 0;
+    for (auto& report : group.reports)
+    {
+        if (toUnixTime(report.minute.timeCode) != winner->first) continue;
+        numAgreeing++;
+
+        if (best == nullptr ||
+            report.minute.haveSample > best->minute.haveSample ||
+            (report.minute.haveSample == best->minute.haveSample && report.minute.snr > best->minute.snr))
+        {
+            best = &report;
+        }
+    }
+
+    const TimeCode& timeCode = best->minute.timeCode;
+    if (out_ != nullptr)
+    {
+        *out_ << "Day " << timeCode.dayOfYear << " of year " << timeCode.year << ", "
+              << timeCode.hour << ":" << std::setfill('0') << std::setw(2) << timeCode.minute << " UTC"
+              << " from " << names_[best->input]
+              << " (SNR " << std::fixed << std::setprecision(1) << best->minute.snr << " dB, "
+              << numAgreeing << " of " << names_.size() << " inputs agree)"
+              << std::defaultfloat << std::endl;
+    }
+
+    if (best->minute.haveSample)
+    {
+        for (auto& refclock : refclocks_)
+        {
+            refclock->send(best->minute.sample);
+        }
+    }
+}
+
+void MinuteFusion::run_timer()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        // Sleep until a live group is due or a new one comes in.
+        auto due = Clock::time_point::max();
+        for (auto& group : pending_)
+        {
+            if (group.live)
+            {
+                due = std::min(due, group.deadline);
+            }
+        }
+
+        if (due == Clock::time_point::max())
+        {
+            changed_.wait(lock);
+        }
+        else
+        {
+            changed_.wait_until(lock, due);
+        }
+
+        resolve_ready(false);
+    }
+}
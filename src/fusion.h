@@ -0,0 +1,100 @@
+#ifndef _FUSION_H
+#define _FUSION_H
+
+#include <chrono>
+#include <condition_variable>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "decoder.h"
+#include "refclock.h"
+
+//=========================================================
+// Combines what several decoders (e.g. one per WWV band)
+// made of the same minute and passes the result on to the
+// refclocks.
+//
+// Reports are grouped by when the minute began on the host
+// clock, or by the decoded time for recorded input, which
+// has no host time. A group is resolved once every input
+// has either reported or moved on to a later minute. For
+// live input, it is also resolved after MAX_WAIT, so that
+// an input that lost the signal doesn't hold up the others.
+// Each report votes for its decoded time with its tick-to-
+// noise ratio. Of the reports that agree with the winner,
+// the one with the highest SNR gives the timestamp.
+//
+// Decoders call add() from their own threads. Everything
+// runs under one lock, but only once a minute per input.
+//=========================================================
+class MinuteFusion
+{
+public:
+    // How long to wait for the other inputs (live input only).
+    static constexpr std::chrono::milliseconds MAX_WAIT{2000};
+
+    // Reports less than this far apart (in seconds) are of the
+    // same minute.
+    static constexpr double SAME_MINUTE = 5;
+
+    // out gets a line per resolved minute; nullptr for none.
+    MinuteFusion(const std::vector<std::string>& inputNames,
+                 std::vector<std::unique_ptr<RefclockDriver>>& refclocks,
+                 std::ostream* out);
+    ~MinuteFusion();
+
+    void add(size_t input, const DecodedMinute& minute);
+
+    // The input has ended and won't report anything more.
+    void input_finished(size_t input);
+
+private:
+    MinuteFusion(const MinuteFusion&) = delete;
+    MinuteFusion& operator=(const MinuteFusion&) = delete;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Report
+    {
+        size_t input;
+        DecodedMinute minute;
+    };
+
+    struct Group
+    {
+        double key;
+        bool live;
+        Clock::time_point deadline;
+        std::vector<Report> reports;
+    };
+
+    std::vector<std::string> names_;
+    std::vector<std::unique_ptr<RefclockDriver>>& refclocks_;
+    std::ostream* out_;
+
+    // Latest key each input has reported, and whether it's done.
+    std::vector<double> latestKey_;
+    std::vector<bool> finished_;
+
+    // In key order.
+    std::vector<Group> pending_;
+    double lastResolvedKey_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool stopping_;
+    std::thread timer_;
+
+    static double key_of(const DecodedMinute& minute);
+
+    bool ready(const Group& group, Clock::time_point now) const;
+    void resolve_ready(bool all);
+    void resolve(const Group& group);
+    void run_timer();
+};
+
+#endif // _FUSION_H
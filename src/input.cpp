@@ -0,0 +1,132 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "input.h"
+
+SampleReader::SampleReader(int fd)
+    : fd_(fd)
+    , map_(nullptr)
+    , mapSize_(0)
+    , mapOffset_(0)
+    , buffer_(nullptr)
+    , carry_(0)
+    , pendingByte_(0)
+{
+    struct stat st;
+    if (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        // Start from the current offset so that e.g. "wwv < file" after
+        // a partial read by someone else still does the right thing.
+        // From an odd offset, samples in the mapping would be
+        // misaligned, so those are read() instead.
+        off_t start = lseek(fd_, 0, SEEK_CUR);
+        if (start < 0) start = 0;
+        
+        void* map = start % sizeof(int16_t) == 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0) : MAP_FAILED;
+        if (map != MAP_FAILED)
+        {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            map_ = (const uint8_t*)map;
+            mapSize_ = st.st_size;
+            mapOffset_ = start;
+            return;
+        }
+    }
+    
+    buffer_ = (uint8_t*)aligned_alloc(64, CHUNK_BYTES);
+}
+
+SampleReader::~SampleReader()
+{
+    if (map_ != nullptr) munmap((void*)map_, mapSize_);
+    free(buffer_);
+}
+
+bool SampleReader::next(const int16_t*& samples, size_t& count)
+{
+    if (map_ != nullptr)
+    {
+        size_t remaining = (mapSize_ - mapOffset_) & ~(size_t)1;
+        if (remaining == 0) return false;
+        
+        size_t bytes = remaining < CHUNK_BYTES ? remaining : CHUNK_BYTES;
+        samples = (const int16_t*)(map_ + mapOffset_);
+        count = bytes / sizeof(int16_t);
+        mapOffset_ += bytes;
+        return true;
+    }
+    
+    if (buffer_ == nullptr) return false;
+    
+    // The caller is done with the previous span, so the leftover half 
+    // sample can go back to the front of the buffer.
+    if (carry_ != 0) buffer_[0] = pendingByte_;
+    
+    for (;;)
+    {
+        ssize_t numRead = read(fd_, buffer_ + carry_, CHUNK_BYTES - carry_);
+        if (numRead < 0 && errno == EINTR) continue;
+        if (numRead <= 0) return false;
+        
+        size_t total = carry_ + numRead;
+        if (total < sizeof(int16_t))
+        {
+            // Only half a sample so far, keep reading.
+            carry_ = total;
+            continue;
+        }
+        
+        samples = (const int16_t*)buffer_;
+        count = total / sizeof(int16_t);
+        
+        carry_ = total % sizeof(int16_t);
+        if (carry_ != 0)
+        {
+            pendingByte_ = buffer_[total - 1];
+        }
+        return true;
+    }
+}
+
+bool SampleReader::next_bytes(const uint8_t*& data, size_t& size)
+{
+    if (map_ != nullptr)
+    {
+        size_t remaining = mapSize_ - mapOffset_;
+        if (remaining == 0) return false;
+        
+        size = remaining < CHUNK_BYTES ? remaining : CHUNK_BYTES;
+        data = map_ + mapOffset_;
+        mapOffset_ += size;
+        return true;
+    }
+    
+    if (buffer_ == nullptr) return false;
+    
+    for (;;)
+    {
+        ssize_t numRead = read(fd_, buffer_, CHUNK_BYTES);
+        if (numRead < 0 && errno == EINTR) continue;
+        if (numRead <= 0) return false;
+        
+        data = buffer_;
+        size = numRead;
+        return true;
+    }
+}
+
+const int16_t* SampleReader::mapped_samples(size_t& count) const
+{
+    if (map_ == nullptr)
+    {
+        count = 0;
+        return nullptr;
+    }
+    
+    count = (mapSize_ - mapOffset_) / sizeof(int16_t);
+    return (const int16_t*)(map_ + mapOffset_);
+}
@@ -0,0 +1,73 @@
+#ifndef _INPUT_H
+#define _INPUT_H
+
+#include <cstddef>
+#include <cstdint>
+
+//=========================================================
+// Anything that hands out 16 bit mono samples at the input
+// sample rate in large spans.
+//=========================================================
+class SampleSource
+{
+public:
+    virtual ~SampleSource() = default;
+    
+    // Returns false once the input is exhausted. The returned span 
+    // stays valid until the next call.
+    virtual bool next(const int16_t*& samples, size_t& count) = 0;
+    
+    // True for a regular file, which has no meaningful read times.
+    virtual bool is_mapped() const = 0;
+    
+    // How many samples the returned ones lag behind what has been
+    // read (e.g. filter delay), for timestamping.
+    virtual double latency() const { return 0; }
+};
+
+//=========================================================
+// Hands out 16 bit mono samples from a file descriptor in 
+// large spans. Regular files are memory mapped and returned
+// in place; pipes and FIFOs (e.g. rtl_fm's output), and files
+// opened at an odd byte offset, are read in 64 KiB chunks into
+// a single reusable aligned buffer.
+//=========================================================
+class SampleReader : public SampleSource
+{
+public:
+    static const size_t CHUNK_BYTES = 64 * 1024;
+    
+    explicit SampleReader(int fd);
+    ~SampleReader() override;
+    
+    bool next(const int16_t*& samples, size_t& count) override;
+    
+    // Same for raw bytes, for other sample formats. Spans may end
+    // in the middle of a sample. Don't mix with next().
+    bool next_bytes(const uint8_t*& data, size_t& size);
+    
+    bool is_mapped() const override { return map_ != nullptr; }
+    
+    // All of a mapped file (from where it was opened at), for random
+    // access. Nothing for pipes, or a file opened at an odd offset.
+    const int16_t* mapped_samples(size_t& count) const;
+    
+private:
+    SampleReader(const SampleReader&) = delete;
+    SampleReader& operator=(const SampleReader&) = delete;
+    
+    int fd_;
+    
+    // mmap() case
+    const uint8_t* map_;
+    size_t mapSize_;
+    size_t mapOffset_;
+    
+    // read() case. carry_ is 1 when the previous read() ended
+    // in the middle of a sample.
+    uint8_t* buffer_;
+    size_t carry_;
+    uint8_t pendingByte_;
+};
+
+#endif // _INPUT_H
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "iq.h"
+
+namespace
+{
+
+// Time constant of the carrier level the envelope is taken
+// relative to, in seconds. Much longer than any symbol, so the
+// 100 Hz subcarrier and ticks pass through untouched.
+const double CARRIER_TIME_CONSTANT = 1.0;
+
+// Audio level of 100% modulation.
+const float AUDIO_SCALE = 16384;
+
+const int FIR_TAPS_PER_FACTOR = 32;
+
+// The FIR stage decimates by the smallest factor of the total,
+// leaving as much as possible to the (much cheaper) CIC. Returns
+// 1 if the rates don't work.
+int firFactorFor(int inputRate, int outputRate)
+{
+    if (outputRate <= 0 || inputRate % outputRate != 0 || inputRate / outputRate < 2)
+    {
+        return 1;
+    }
+
+    int total = inputRate / outputRate;
+    for (int factor = 2; factor * factor <= total; factor++)
+    {
+        if (total % factor == 0) return factor;
+    }
+    return total;
+}
+
+}
+
+IqDemodulator::IqDemodulator(IqFormat format, int inputRate, int outputRate)
+    : format_(format)
+    , pairBytes_(format == IQ_U8 ? 2 : 4)
+    , cicFactor_(0)
+    , firFactor_(firFactorFor(inputRate, outputRate))
+    , carrySize_(0)
+    , integrators_()
+    , combs_()
+    , cicPhase_(0)
+    , cicScale_(0)
+    , iDecimator_(firFactor_, FIR_TAPS_PER_FACTOR * firFactor_, (double)outputRate * firFactor_)
+    , qDecimator_(firFactor_, FIR_TAPS_PER_FACTOR * firFactor_, (double)outputRate * firFactor_)
+    , carrierRise_(1 - exp(-1.0 / (CARRIER_TIME_CONSTANT * outputRate)))
+    , carrier_(0)
+    , carrierCount_(0)
+    , iIn_(BLOCK_PAIRS)
+    , qIn_(BLOCK_PAIRS)
+    , iCic_(BLOCK_PAIRS + 1)
+    , qCic_(BLOCK_PAIRS + 1)
+    , iOut_(BLOCK_PAIRS + 1)
+    , qOut_(BLOCK_PAIRS + 1)
+{
+    if (firFactor_ == 1)
+    {
+        return;
+    }
+
+    cicFactor_ = inputRate / outputRate / firFactor_;
+
+    // Full scale in comes out of the CIC as +/-1. u8 samples are
+    // converted to 2x - 255 to keep them integer.
+    double fullScale = format_ == IQ_U8 ? 255 : 32768;
+    cicScale_ = 1.0 / (pow(cicFactor_, CIC_ORDER) * fullScale);
+}
+
+double IqDemodulator::latency() const
+{
+    // CIC: CIC_ORDER boxcars of cicFactor_ input samples. FIR: linear
+    // phase at the intermediate rate.
+    double total = (double)cicFactor_ * firFactor_;
+    double cicDelay = CIC_ORDER * (cicFactor_ - 1) / 2.0 / total;
+    double firDelay = (FIR_TAPS_PER_FACTOR * firFactor_ - 1) / 2.0 / firFactor_;
+    return cicDelay + firDelay;
+}
+
+size_t IqDemodulator::process(const uint8_t* data, size_t size, int16_t* out)
+{
+    size_t numOut = 0;
+
+    // Finish the pair started last time.
+    if (carrySize_ > 0)
+    {
+        size_t needed = std::min(pairBytes_ - carrySize_, size);
+        memcpy(carry_ + carrySize_, data, needed);
+        carrySize_ += needed;
+        data += needed;
+        size -= needed;
+
+        if (carrySize_ < pairBytes_)
+        {
+            return 0;
+        }
+        numOut += demodulate(carry_, 1, out);
+        carrySize_ = 0;
+    }
+
+    size_t numPairs = size / pairBytes_;
+    while (numPairs > 0)
+    {
+        size_t blockPairs = std::min(numPairs, BLOCK_PAIRS);
+        numOut += demodulate(data, blockPairs, out + numOut);
+        data += blockPairs * pairBytes_;
+        numPairs -= blockPairs;
+    }
+
+    carrySize_ = size % pairBytes_;
+    memcpy(carry_, data, carrySize_);
+    return numOut;
+}
+
+size_t IqDemodulator::demodulate(const uint8_t* data, size_t numPairs, int16_t* out)
+{
+    int32_t* iIn = iIn_.data();
+    int32_t* qIn = qIn_.data();
+
+    // Deinterleave. Both loops vectorize.
+    if (format_ == IQ_U8)
+    {
+        for (size_t k = 0; k < numPairs; k++)
+        {
+            iIn[k] = 2 * data[2 * k] - 255;
+            qIn[k] = 2 * data[2 * k + 1] - 255;
+        }
+    }
+    else
+    {
+        for (size_t k = 0; k < numPairs; k++)
+        {
+            int16_t pair[2];
+            memcpy(pair, data + 4 * k, sizeof(pair));
+            iIn[k] = pair[0];
+            qIn[k] = pair[1];
+        }
+    }
+
+    // CIC. The integrators are a recurrence in time, so I and Q
+    // side by side are all the parallelism there is.
+    size_t numCic = 0;
+    for (size_t k = 0; k < numPairs; k++)
+    {
+        uint64_t x[2] = {(uint64_t)(int64_t)iIn[k], (uint64_t)(int64_t)qIn[k]};
+        for (int lane = 0; lane < 2; lane++)
+        {
+            integrators_[0][lane] += x[lane];
+            for (int stage = 1; stage < CIC_ORDER; stage++)
+            {
+                integrators_[stage][lane] += integrators_[stage - 1][lane];
+            }
+        }
+
+        // Like Decimator, output m ends with input m * cicFactor_.
+        bool complete = cicPhase_ == 0;
+        cicPhase_ = (cicPhase_ + 1) % cicFactor_;
+        if (!complete)
+        {
+            continue;
+        }
+
+        float y[2];
+        for (int lane = 0; lane < 2; lane++)
+        {
+            uint64_t value = integrators_[CIC_ORDER - 1][lane];
+            for (int stage = 0; stage < CIC_ORDER; stage++)
+            {
+                uint64_t previous = combs_[stage][lane];
+                combs_[stage][lane] = value;
+                value -= previous;
+            }
+            y[lane] = (int64_t)value * cicScale_;
+        }
+        iCic_[numCic] = y[0];
+        qCic_[numCic] = y[1];
+        numCic++;
+    }
+
+    size_t numOut = iDecimator_.process(iCic_.data(), numCic, iOut_.data());
+    qDecimator_.process(qCic_.data(), numCic, qOut_.data());
+
+    for (size_t k = 0; k < numOut; k++)
+    {
+        float envelope = sqrt(iOut_[k] * iOut_[k] + qOut_[k] * qOut_[k]);
+        // Plain running mean until there's a time constant's worth,
+        // so the level is right from the start.
+        carrierCount_++;
+        carrier_ += (envelope - carrier_) * std::max(carrierRise_, 1.0f / carrierCount_);
+
+        float audio = carrier_ > 0 ? (envelope - carrier_) / carrier_ * AUDIO_SCALE : 0;
+        out[k] = (int16_t)std::clamp(audio, -32767.0f, 32767.0f);
+    }
+
+    return numOut;
+}
+
+IqReader::IqReader(SampleReader& reader, IqFormat format, int inputRate, int outputRate)
+    : reader_(reader)
+    , demodulator_(format, inputRate, outputRate)
+{
+    // Enough for a whole chunk of u8 pairs, the smallest format.
+    size_t decimation = std::max(demodulator_.cic_factor() * demodulator_.fir_factor(), 1);
+    audio_.resize(SampleReader::CHUNK_BYTES / 2 / decimation + 2);
+}
+
+bool IqReader::next(const int16_t*& samples, size_t& count)
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    while (reader_.next_bytes(data, size))
+    {
+        count = demodulator_.process(data, size, audio_.data());
+        if (count > 0)
+        {
+            samples = audio_.data();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,115 @@
+#ifndef _IQ_H
+#define _IQ_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "decimator.h"
+#include "input.h"
+
+// rtl_sdr rate that's a multiple of 8 kHz (126x) and clear of
+// the range its tuner can't do.
+const int DEFAULT_IQ_RATE = 1008000;
+
+enum IqFormat
+{
+    IQ_U8,  // rtl_sdr's native format, offset by 127.5
+    IQ_S16, // signed 16 bit, native endian
+};
+
+//=========================================================
+// AM receiver for raw interleaved I/Q (e.g. from rtl_sdr
+// tuned to the carrier), so that no rtl_fm is needed in
+// front of the decoder.
+//
+// I and Q are decimated separately in two stages. First, an
+// integer CIC filter (CIC_ORDER integrators running at the
+// input rate, combs at the output rate) takes them down to
+// firFactor times the output rate for the cost of a few
+// adds per sample. Then a polyphase FIR (see Decimator)
+// sets the channel bandwidth at 40% of the output rate and
+// does the rest. The audio is the envelope |I + jQ| of what
+// is left. It's relative to a slow average of the envelope,
+// i.e. the carrier level, so it's the same level however
+// strong the station is.
+//=========================================================
+class IqDemodulator
+{
+public:
+    static const int CIC_ORDER = 4;
+
+    // The input rate has to be a multiple (at least 2) of the
+    // output rate; check valid() afterwards.
+    IqDemodulator(IqFormat format, int inputRate, int outputRate);
+
+    bool valid() const { return cicFactor_ > 0; }
+
+    int cic_factor() const { return cicFactor_; }
+    int fir_factor() const { return firFactor_; }
+
+    // Converts any number of raw bytes to audio; anything after the
+    // last whole I/Q pair is kept for next time. Returns how many
+    // samples were written to out, at most
+    // (size / bytes per pair) / (cic_factor() * fir_factor()) + 1.
+    size_t process(const uint8_t* data, size_t size, int16_t* out);
+
+    // Group delay of the two stages, in output samples.
+    double latency() const;
+
+private:
+    static const size_t BLOCK_PAIRS = 4096;
+
+    IqFormat format_;
+    size_t pairBytes_;
+    int cicFactor_;
+    int firFactor_;
+
+    // Partial I/Q pair left over from the last call.
+    uint8_t carry_[4];
+    size_t carrySize_;
+
+    // CIC state for I (index 0) and Q (index 1). Integer arithmetic
+    // wraps around, which the combs undo exactly.
+    uint64_t integrators_[CIC_ORDER][2];
+    uint64_t combs_[CIC_ORDER][2];
+    int cicPhase_;
+    float cicScale_;
+
+    Decimator iDecimator_;
+    Decimator qDecimator_;
+
+    float carrierRise_;
+    float carrier_;
+    uint64_t carrierCount_;
+
+    // Per-block buffers.
+    std::vector<int32_t> iIn_, qIn_;
+    std::vector<float> iCic_, qCic_;
+    std::vector<float> iOut_, qOut_;
+
+    size_t demodulate(const uint8_t* data, size_t numPairs, int16_t* out);
+};
+
+//=========================================================
+// SampleSource for I/Q input: reads raw bytes from a
+// SampleReader and hands out the demodulated audio.
+//=========================================================
+class IqReader : public SampleSource
+{
+public:
+    IqReader(SampleReader& reader, IqFormat format, int inputRate, int outputRate);
+
+    bool valid() const { return demodulator_.valid(); }
+
+    bool next(const int16_t*& samples, size_t& count) override;
+    bool is_mapped() const override { return reader_.is_mapped(); }
+    double latency() const override { return demodulator_.latency(); }
+
+private:
+    SampleReader& reader_;
+    IqDemodulator demodulator_;
+    std::vector<int16_t> audio_;
+};
+
+#endif // _IQ_H
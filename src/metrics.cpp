@@ -0,0 +1,414 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+namespace
+{
+
+// Upper bounds of the mismatch ratio buckets. fuzzyMatch() takes
+// up to MAX_MISMATCH_RATIO (0.12), the classifier up to 0.25.
+const std::initializer_list<double> MISMATCH_BOUNDS = {0.01, 0.02, 0.04, 0.06, 0.08, 0.1, 0.12, 0.15, 0.2, 0.25, 0.5};
+
+// How long a client gets to send its request.
+const int REQUEST_TIMEOUT_MS = 1000;
+
+std::string escapeLabel(const std::string& value)
+{
+    std::string escaped;
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"') escaped += '\\';
+        if (c == '\n')
+        {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// The text format spells these differently from iostreams.
+void writeValue(std::ostream& out, double value)
+{
+    if (std::isnan(value)) out << "NaN";
+    else if (std::isinf(value)) out << (value > 0 ? "+Inf" : "-Inf");
+    else out << value;
+}
+
+void writeValue(std::ostream& out, uint64_t value)
+{
+    out << value;
+}
+
+}
+
+const char* const DecoderMetrics::STAGE_NAMES[NUM_STAGES] = {
+    "dc_block", "ticks", "decimate", "quadrature", "bandpass", "agc", "envelope", "noise_gate", "decode"};
+
+const char DecoderMetrics::SYMBOL_NAMES[NUM_SYMBOLS] = {'R', 'P', '1', '0', '?'};
+
+const char* const DecoderMetrics::LOST_DURING_NAMES[NUM_LOST_DURING] = {"reference", "data", "position"};
+
+const char* const DecoderMetrics::STATION_NAMES[NUM_STATIONS] = {"wwv", "wwvh"};
+
+Histogram::Histogram(std::initializer_list<double> bounds)
+    : numBounds_(std::min(bounds.size(), MAX_BUCKETS))
+    , bounds_()
+{
+    std::copy(bounds.begin(), bounds.begin() + numBounds_, bounds_.begin());
+}
+
+void Histogram::observe(double value)
+{
+    size_t bucket = 0;
+    while (bucket < numBounds_ && value > bounds_[bucket])
+    {
+        bucket++;
+    }
+
+    counts_[bucket].add();
+    count_.add();
+    sum_.set(sum_.value() + value);
+}
+
+DecoderMetrics::DecoderMetrics()
+    : mismatchRatio{{MISMATCH_BOUNDS, MISMATCH_BOUNDS, MISMATCH_BOUNDS, MISMATCH_BOUNDS}}
+{
+    // Nothing else to do.
+}
+
+size_t DecoderMetrics::symbol_index(char symbol)
+{
+    const char* found = std::find(SYMBOL_NAMES, SYMBOL_NAMES + NUM_SYMBOLS, symbol);
+    return std::min<size_t>(found - SYMBOL_NAMES, NUM_SYMBOLS - 1);
+}
+
+uint64_t DecoderMetrics::now_nanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+MetricsServer::MetricsServer(const std::string& address, const Sources& sources)
+    : sources_(sources)
+    , listenFd_(-1)
+    , wakeFds_{-1, -1}
+{
+    bool listening = address.find('/') != std::string::npos ? listen_unix(address) : listen_tcp(address);
+    if (!listening)
+    {
+        return;
+    }
+
+    if (pipe2(wakeFds_, O_CLOEXEC) == -1)
+    {
+        std::cerr << "metrics: pipe: " << strerror(errno) << std::endl;
+        close(listenFd_);
+        listenFd_ = -1;
+        return;
+    }
+
+    thread_ = std::thread(&MetricsServer::serve, this);
+}
+
+MetricsServer::~MetricsServer()
+{
+    if (thread_.joinable())
+    {
+        char stop = 0;
+        (void)!write(wakeFds_[1], &stop, 1);
+        thread_.join();
+    }
+
+    for (int fd : {listenFd_, wakeFds_[0], wakeFds_[1]})
+    {
+        if (fd != -1) close(fd);
+    }
+
+    if (!unixPath_.empty())
+    {
+        unlink(unixPath_.c_str());
+    }
+}
+
+bool MetricsServer::listen_tcp(const std::string& address)
+{
+    size_t colon = address.rfind(':');
+    std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+    std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+
+    addrinfo* addresses = nullptr;
+    int error = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+    if (error != 0)
+    {
+        std::cerr << "metrics: " << address << ": " << gai_strerror(error) << std::endl;
+        return false;
+    }
+
+    for (addrinfo* ai = addresses; ai != nullptr && listenFd_ == -1; ai = ai->ai_next)
+    {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd == -1) continue;
+
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, SOMAXCONN) == 0)
+        {
+            listenFd_ = fd;
+        }
+        else
+        {
+            error = errno;
+            close(fd);
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (listenFd_ == -1)
+    {
+        std::cerr << "metrics: " << address << ": " << strerror(error) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MetricsServer::listen_unix(const std::string& path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "metrics: " << path << ": path too long" << std::endl;
+        return false;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    // A socket left over from a previous run, but nothing else.
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        unlink(path.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 || bind(fd, (sockaddr*)&addr, sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1)
+    {
+        std::cerr << "metrics: " << path << ": " << strerror(errno) << std::endl;
+        if (fd != -1) close(fd);
+        return false;
+    }
+
+    listenFd_ = fd;
+    unixPath_ = path;
+    return true;
+}
+
+void MetricsServer::serve()
+{
+    while (true)
+    {
+        pollfd fds[2] = {{listenFd_, POLLIN, 0}, {wakeFds_[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) == -1)
+        {
+            if (errno == EINTR) continue;
+            std::cerr << "metrics: poll: " << strerror(errno) << std::endl;
+            return;
+        }
+
+        if (fds[1].revents != 0)
+        {
+            return;
+        }
+
+        int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd != -1)
+        {
+            answer(fd);
+            close(fd);
+        }
+    }
+}
+
+void MetricsServer::answer(int fd) const
+{
+    // Only the request line matters; the rest is read so that the
+    // client doesn't see a reset.
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos)
+    {
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0) return;
+
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) return;
+        request.append(buffer, n);
+        if (request.size() > 16 * 1024) return;
+    }
+
+    std::istringstream requestLine(request.substr(0, request.find_first_of("\r\n")));
+    std::string method, target;
+    requestLine >> method >> target;
+
+    std::ostringstream body;
+    std::string status = "200 OK";
+    if (method != "GET" && method != "HEAD")
+    {
+        status = "405 Method Not Allowed";
+    }
+    else if (target != "/metrics" && target != "/")
+    {
+        status = "404 Not Found";
+    }
+    else
+    {
+        write_metrics(body);
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.0 " << status << "\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.str().size() << "\r\n"
+             << "Connection: close\r\n\r\n";
+    if (method != "HEAD")
+    {
+        response << body.str();
+    }
+
+    std::string text = response.str();
+    for (size_t sent = 0; sent < text.size();)
+    {
+        ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        sent += n;
+    }
+}
+
+void MetricsServer::write_metrics(std::ostream& out) const
+{
+    auto family = [&](const char* name, const char* type, const char* help) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " " << type << "\n";
+    };
+
+    // One line per input, with the extra label (if any) first.
+    auto each = [&](const char* name, const std::string& extraLabel, auto value) {
+        for (auto& source : sources_)
+        {
+            out << name << "{" << extraLabel << (extraLabel.empty() ? "" : ",")
+                << "input=\"" << escapeLabel(source.first) << "\"} ";
+            writeValue(out, value(*source.second));
+            out << "\n";
+        }
+    };
+
+    out.precision(9);
+
+    family("wwv_samples_total", "counter", "Input samples processed.");
+    each("wwv_samples_total", "", [](const DecoderMetrics& m) { return m.samples.value(); });
+
+    family("wwv_stage_seconds_total", "counter", "Time spent in each processing stage.");
+    for (size_t stage = 0; stage < DecoderMetrics::NUM_STAGES; stage++)
+    {
+        std::string label = std::string("stage=\"") + DecoderMetrics::STAGE_NAMES[stage] + "\"";
+        each("wwv_stage_seconds_total", label, [stage](const DecoderMetrics& m) {
+            return m.stageNanoseconds[stage].value() / 1e9;
+        });
+    }
+
+    family("wwv_stage_ns_per_sample", "gauge", "Average time per input sample spent in each stage since startup.");
+    for (size_t stage = 0; stage < DecoderMetrics::NUM_STAGES; stage++)
+    {
+        std::string label = std::string("stage=\"") + DecoderMetrics::STAGE_NAMES[stage] + "\"";
+        each("wwv_stage_ns_per_sample", label, [stage](const DecoderMetrics& m) {
+            return (double)m.stageNanoseconds[stage].value() / std::max<uint64_t>(m.samples.value(), 1);
+        });
+    }
+
+    family("wwv_ticks_total", "counter", "Second ticks detected, by the station they came from.");
+    for (size_t station = 0; station < NUM_STATIONS; station++)
+    {
+        std::string label = std::string("station=\"") + DecoderMetrics::STATION_NAMES[station] + "\"";
+        each("wwv_ticks_total", label, [station](const DecoderMetrics& m) { return m.ticks[station].value(); });
+    }
+
+    family("wwv_agc_gain_db", "gauge", "Gain the AGC applied at the end of the last block.");
+    each("wwv_agc_gain_db", "", [](const DecoderMetrics& m) { return m.agcGain.value(); });
+
+    family("wwv_noise_gate_threshold_db", "gauge", "Noise gate release threshold.");
+    each("wwv_noise_gate_threshold_db", "", [](const DecoderMetrics& m) { return m.noiseGateThreshold.value(); });
+
+    family("wwv_symbols_total", "counter", "Symbols decoded, ? for erasures.");
+    for (size_t symbol = 0; symbol < DecoderMetrics::NUM_SYMBOLS; symbol++)
+    {
+        std::string label = std::string("symbol=\"") + DecoderMetrics::SYMBOL_NAMES[symbol] + "\"";
+        each("wwv_symbols_total", label, [symbol](const DecoderMetrics& m) { return m.symbols[symbol].value(); });
+    }
+
+    family("wwv_symbol_mismatch_ratio", "histogram", "Fraction of each decoded symbol that disagreed with its template.");
+    for (auto& source : sources_)
+    {
+        std::string input = "input=\"" + escapeLabel(source.first) + "\"";
+        for (size_t symbol = 0; symbol + 1 < DecoderMetrics::NUM_SYMBOLS; symbol++)
+        {
+            const Histogram& histogram = source.second->mismatchRatio[symbol];
+            std::string labels = std::string("symbol=\"") + DecoderMetrics::SYMBOL_NAMES[symbol] + "\"," + input;
+
+            uint64_t cumulative = 0;
+            for (size_t bucket = 0; bucket < histogram.num_buckets(); bucket++)
+            {
+                cumulative += histogram.bucket_count(bucket);
+                out << "wwv_symbol_mismatch_ratio_bucket{" << labels << ",le=\"";
+                if (bucket + 1 < histogram.num_buckets()) out << histogram.bound(bucket);
+                else out << "+Inf";
+                out << "\"} " << cumulative << "\n";
+            }
+            out << "wwv_symbol_mismatch_ratio_sum{" << labels << "} ";
+            writeValue(out, histogram.sum());
+            out << "\nwwv_symbol_mismatch_ratio_count{" << labels << "} " << histogram.count() << "\n";
+        }
+    }
+
+    family("wwv_locks_total", "counter", "Times the decoder found the phase of the seconds.");
+    each("wwv_locks_total", "", [](const DecoderMetrics& m) { return m.locks.value(); });
+
+    family("wwv_sync_losses_total", "counter", "Times the decoder lost sync, by what it was waiting for.");
+    for (size_t during = 0; during < DecoderMetrics::NUM_LOST_DURING; during++)
+    {
+        std::string label = std::string("during=\"") + DecoderMetrics::LOST_DURING_NAMES[during] + "\"";
+        each("wwv_sync_losses_total", label, [during](const DecoderMetrics& m) { return m.losses[during].value(); });
+    }
+
+    family("wwv_locked", "gauge", "Whether the decoder is synced to the time code (1) or searching (0).");
+    each("wwv_locked", "", [](const DecoderMetrics& m) { return m.locked.value(); });
+
+    family("wwv_time_codes_total", "counter", "Minutes decoded.");
+    each("wwv_time_codes_total", "", [](const DecoderMetrics& m) { return m.timeCodes.value(); });
+
+    family("wwv_time_code_age_seconds", "gauge", "Time since the last minute was decoded (NaN if none has been).");
+    double now = DecoderMetrics::now_nanoseconds() / 1e9;
+    each("wwv_time_code_age_seconds", "", [now](const DecoderMetrics& m) {
+        double last = m.lastTimeCode.value();
+        return last > 0 ? now - last : NAN;
+    });
+}
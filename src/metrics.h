@@ -0,0 +1,185 @@
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tick.h"
+
+//=========================================================
+// Counters, gauges and histograms for watching a decoder
+// from outside. Every metric has exactly one thread writing
+// it, so updates are plain relaxed loads and stores with no
+// locked instructions or fences, cheap enough for the DSP
+// loop. Any thread can read them at any time; a histogram
+// read while it's being updated may be one observation off
+// between its buckets and its count, which doesn't matter
+// for monitoring.
+//=========================================================
+class Counter
+{
+public:
+    void add(uint64_t n = 1) { value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge
+{
+public:
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0};
+};
+
+class Histogram
+{
+public:
+    static const size_t MAX_BUCKETS = 15;
+
+    // Upper bounds of the buckets, in increasing order. Anything
+    // above the last one goes in an extra +Inf bucket.
+    Histogram(std::initializer_list<double> bounds);
+
+    void observe(double value);
+
+    size_t num_buckets() const { return numBounds_ + 1; }
+    double bound(size_t bucket) const { return bounds_[bucket]; }
+    uint64_t bucket_count(size_t bucket) const { return counts_[bucket].value(); }
+    uint64_t count() const { return count_.value(); }
+    double sum() const { return sum_.value(); }
+
+private:
+    size_t numBounds_;
+    std::array<double, MAX_BUCKETS> bounds_;
+    std::array<Counter, MAX_BUCKETS + 1> counts_;
+    Counter count_;
+    Gauge sum_;
+};
+
+// What a WwvDecoder reports (see WwvDecoder::set_metrics()).
+// The first group is written by detect(), the second by
+// decode(), so each has a single writer even when the two
+// run on different threads.
+struct DecoderMetrics
+{
+    enum Stage
+    {
+        DC_BLOCK_STAGE,
+        TICK_STAGE,
+        DECIMATE_STAGE,
+        QUADRATURE_STAGE,
+        BANDPASS_STAGE,
+        AGC_STAGE,
+        ENVELOPE_STAGE,
+        NOISE_GATE_STAGE,
+        DECODE_STAGE, // symbol matching and state machine (and gating during the phase search)
+        NUM_STAGES,
+    };
+    static const char* const STAGE_NAMES[NUM_STAGES];
+
+    // Symbols in the order of SYMBOL_NAMES; the last one is
+    // erasures.
+    static const size_t NUM_SYMBOLS = 5;
+    static const char SYMBOL_NAMES[NUM_SYMBOLS];
+
+    enum LostDuring
+    {
+        LOST_DURING_REFERENCE,
+        LOST_DURING_DATA,
+        LOST_DURING_POSITION,
+        NUM_LOST_DURING,
+    };
+    static const char* const LOST_DURING_NAMES[NUM_LOST_DURING];
+
+    // Indexed by Station.
+    static const char* const STATION_NAMES[NUM_STATIONS];
+
+    // detect()
+    Counter samples;
+    std::array<Counter, NUM_STATIONS> ticks;
+    Gauge agcGain; // dB, as of the end of the last block
+
+    // Time spent in each stage (both halves). NOISE_GATE_STAGE
+    // and DECODE_STAGE belong to decode().
+    std::array<Counter, NUM_STAGES> stageNanoseconds;
+
+    // decode()
+    Gauge noiseGateThreshold; // dB
+    std::array<Counter, NUM_SYMBOLS> symbols;
+
+    // Fraction of samples that disagreed with the template of each
+    // decoded symbol (R, P, 1, 0). Once locked this is from the
+    // soft values, i.e. (1 - normalized correlation) / 2.
+    std::array<Histogram, NUM_SYMBOLS - 1> mismatchRatio;
+
+    Counter locks;
+    std::array<Counter, NUM_LOST_DURING> losses;
+    Gauge locked;
+
+    Counter timeCodes;
+    Gauge lastTimeCode; // CLOCK_MONOTONIC seconds, 0 for never
+
+    DecoderMetrics();
+
+    static size_t symbol_index(char symbol);
+    static uint64_t now_nanoseconds();
+};
+
+//=========================================================
+// Serves the metrics of any number of decoders in the
+// Prometheus text format from a thread of its own, over
+// HTTP on a local TCP port or a Unix socket:
+//
+//   curl http://localhost:9464/metrics
+//   curl --unix-socket /run/wwv.sock http://localhost/metrics
+//
+// One request per connection, answered and closed, which is
+// all a scraper needs.
+//=========================================================
+class MetricsServer
+{
+public:
+    typedef std::vector<std::pair<std::string, const DecoderMetrics*>> Sources;
+
+    // address is [HOST:]PORT (HOST defaults to 127.0.0.1) or the
+    // path of a Unix socket (anything with a / in it). Each source
+    // is labelled with its input's name.
+    MetricsServer(const std::string& address, const Sources& sources);
+    ~MetricsServer();
+
+    // False if the socket couldn't be set up (and says why on
+    // stderr).
+    bool is_open() const { return listenFd_ != -1; }
+
+    void write_metrics(std::ostream& out) const;
+
+private:
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    std::string unixPath_;
+    Sources sources_;
+    int listenFd_;
+    int wakeFds_[2];
+    std::thread thread_;
+
+    bool listen_tcp(const std::string& address);
+    bool listen_unix(const std::string& path);
+    void serve();
+    void answer(int fd) const;
+};
+
+#endif // _METRICS_H
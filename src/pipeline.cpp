@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+#include "fir.h"
+#include "pipeline.h"
+
+bool pinThread(int cpu)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (err != 0)
+    {
+        std::cerr << "Can't pin thread to CPU " << cpu << ": " << strerror(err) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Pipeline::Pipeline(WwvDecoder& decoder, const PipelineOptions& options)
+    : decoder_(decoder)
+    , options_(options)
+    , samples_(SAMPLE_BLOCKS)
+    , carriers_(CARRIER_BLOCKS)
+    , blocksDropped_(0)
+    , dspStalls_(0)
+{
+    // Nothing else to do.
+}
+
+void Pipeline::run(SampleSource& reader)
+{
+    std::thread dsp(&Pipeline::run_dsp, this);
+    std::thread decode(&Pipeline::run_decode, this);
+
+    if (options_.readerCpu >= 0)
+    {
+        pinThread(options_.readerCpu);
+    }
+
+    const int16_t* samples = nullptr;
+    size_t numSamples = 0;
+    uint64_t samplesRead = 0;
+    while (reader.next(samples, numSamples))
+    {
+        // A mapped file has no meaningful read times, but then
+        // it can also wait for the DSP thread to catch up.
+        bool live = !reader.is_mapped();
+        timespec readTime = {};
+        if (live)
+        {
+            clock_gettime(CLOCK_REALTIME, &readTime);
+        }
+
+        for (size_t offset = 0; offset < numSamples; offset += CarrierBlock::MAX_SAMPLES)
+        {
+            SampleBlock* block = live ? samples_.write_slot() : samples_.wait_write_slot();
+            if (block == nullptr)
+            {
+                blocksDropped_++;
+                continue;
+            }
+
+            block->firstSample = samplesRead + offset;
+            block->count = std::min(numSamples - offset, CarrierBlock::MAX_SAMPLES);
+            std::copy(samples + offset, samples + offset + block->count, block->samples);
+            block->haveReadTime = live;
+            block->readEnd = samplesRead + numSamples + reader.latency();
+            block->readTime = readTime;
+            samples_.commit();
+        }
+
+        samplesRead += numSamples;
+    }
+
+    samples_.close();
+    dsp.join();
+    decode.join();
+}
+
+void Pipeline::run_dsp()
+{
+    enableFlushToZero();
+    if (options_.dspCpu >= 0)
+    {
+        pinThread(options_.dspCpu);
+    }
+
+    static const int16_t silence[CarrierBlock::MAX_SAMPLES] = {};
+
+    uint64_t nextSample = 0;
+    while (SampleBlock* block = samples_.wait_read_slot())
+    {
+        // Stand in for whatever the reader had to drop.
+        while (nextSample < block->firstSample)
+        {
+            size_t count = std::min<uint64_t>(block->firstSample - nextSample, CarrierBlock::MAX_SAMPLES);
+            detect(silence, count, nullptr);
+            nextSample += count;
+        }
+
+        detect(block->samples, block->count, block);
+        nextSample += block->count;
+        samples_.release();
+    }
+
+    carriers_.close();
+}
+
+void Pipeline::detect(const int16_t* samples, size_t count, const SampleBlock* readInfo)
+{
+    DetectedBlock* out = carriers_.write_slot();
+    if (out == nullptr)
+    {
+        dspStalls_++;
+        out = carriers_.wait_write_slot();
+    }
+
+    decoder_.detect(samples, count, out->carriers);
+
+    out->haveReadTime = readInfo != nullptr && readInfo->haveReadTime;
+    if (out->haveReadTime)
+    {
+        out->readEnd = readInfo->readEnd;
+        out->readTime = readInfo->readTime;
+    }
+    carriers_.commit();
+}
+
+void Pipeline::run_decode()
+{
+    enableFlushToZero();
+    if (options_.decodeCpu >= 0)
+    {
+        pinThread(options_.decodeCpu);
+    }
+
+    while (DetectedBlock* block = carriers_.wait_read_slot())
+    {
+        if (block->haveReadTime)
+        {
+            decoder_.update_clock(block->readEnd, block->readTime);
+        }
+
+        decoder_.decode(block->carriers);
+        carriers_.release();
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#include "decoder.h"
+#include "input.h"
+#include "spsc.h"
+
+struct PipelineOptions
+{
+    // CPU to pin each thread to, -1 to leave it to the scheduler.
+    int readerCpu = -1;
+    int dspCpu = -1;
+    int decodeCpu = -1;
+};
+
+//=========================================================
+// Runs one input through a decoder on three threads:
+//
+//   reader --samples--> DSP --carriers--> decode/output
+//
+// The calling thread reads. The DSP thread runs the decoder's
+// detect() half and the decode thread runs decode(), which
+// is also where all output happens. They're joined by lock-
+// free single producer/single consumer rings of blocks, so a
+// stall in writing to stdout (or a slow symbol decode) only
+// holds up the decode thread while reading carries on.
+//
+// The reader never waits on live input: if the DSP thread
+// falls so far behind that the sample ring fills up, the
+// block is dropped and counted, and the DSP thread decodes
+// silence in its place so that timing stays right. When the
+// carrier ring fills up the DSP thread waits (counted as a
+// stall) and lets the sample ring take up the slack.
+//=========================================================
+class Pipeline
+{
+public:
+    // About 32s of input at 8 kHz.
+    static const size_t SAMPLE_BLOCKS = 256;
+    static const size_t CARRIER_BLOCKS = 64;
+
+    Pipeline(WwvDecoder& decoder, const PipelineOptions& options);
+
+    // Reads the input until it ends and returns once everything
+    // read has been decoded.
+    void run(SampleSource& reader);
+
+    uint64_t blocks_dropped() const { return blocksDropped_; }
+    uint64_t dsp_stalls() const { return dspStalls_; }
+
+private:
+    struct SampleBlock
+    {
+        uint64_t firstSample;
+        size_t count;
+        int16_t samples[CarrierBlock::MAX_SAMPLES];
+
+        // The read this block came from, for the clock model.
+        bool haveReadTime;
+        double readEnd;
+        timespec readTime;
+    };
+
+    struct DetectedBlock
+    {
+        CarrierBlock carriers;
+
+        bool haveReadTime;
+        double readEnd;
+        timespec readTime;
+    };
+
+    WwvDecoder& decoder_;
+    PipelineOptions options_;
+
+    SpscRing<SampleBlock> samples_;
+    SpscRing<DetectedBlock> carriers_;
+
+    std::atomic<uint64_t> blocksDropped_;
+    std::atomic<uint64_t> dspStalls_;
+
+    void run_dsp();
+    void run_decode();
+    void detect(const int16_t* samples, size_t count, const SampleBlock* readInfo);
+};
+
+// Pins the calling thread to the given CPU. Returns false (and
+// says why on stderr) if that isn't possible.
+bool pinThread(int cpu);
+
+#endif // _PIPELINE_H
@@ -0,0 +1,163 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "refclock.h"
+
+ShmRefclock::ShmRefclock(int unit)
+    : shm_(nullptr)
+{
+    // Same permissions ntpd uses: the first two units are for root only.
+    int perms = unit <= 1 ? 0600 : 0666;
+    int id = shmget(SHM_KEY_BASE + unit, sizeof(ShmTime), IPC_CREAT | perms);
+    if (id == -1)
+    {
+        std::cerr << "SHM unit " << unit << ": shmget: " << strerror(errno) << std::endl;
+        return;
+    }
+
+    void* addr = shmat(id, nullptr, 0);
+    if (addr == (void*)-1)
+    {
+        std::cerr << "SHM unit " << unit << ": shmat: " << strerror(errno) << std::endl;
+        return;
+    }
+
+    shm_ = (ShmTime*)addr;
+    shm_->mode = 1;
+    shm_->valid = 0;
+    shm_->nsamples = 3;
+}
+
+ShmRefclock::~ShmRefclock()
+{
+    if (shm_ != nullptr)
+    {
+        shmdt(shm_);
+    }
+}
+
+void ShmRefclock::send(const RefclockSample& sample)
+{
+    if (shm_ == nullptr)
+    {
+        samplesDropped_++;
+        return;
+    }
+
+    // Mode 1: the reader takes the sample only if count is the same
+    // before and after it reads, and clears valid when it's done.
+    shm_->valid = 0;
+    shm_->count = shm_->count + 1;
+    __sync_synchronize();
+
+    shm_->clockTimeStampSec = sample.clockTime.tv_sec;
+    shm_->clockTimeStampUSec = sample.clockTime.tv_nsec / 1000;
+    shm_->clockTimeStampNSec = sample.clockTime.tv_nsec;
+    shm_->receiveTimeStampSec = sample.receiveTime.tv_sec;
+    shm_->receiveTimeStampUSec = sample.receiveTime.tv_nsec / 1000;
+    shm_->receiveTimeStampNSec = sample.receiveTime.tv_nsec;
+    shm_->leap = sample.leap;
+    shm_->precision = sample.precision;
+
+    __sync_synchronize();
+    shm_->count = shm_->count + 1;
+    shm_->valid = 1;
+
+    samplesSent_++;
+}
+
+SockRefclock::SockRefclock(const std::string& path)
+    : path_(path)
+    , fd_(-1)
+{
+    if (!connect_socket())
+    {
+        std::cerr << "chrony socket " << path_ << ": " << strerror(errno)
+                  << " (will keep trying)" << std::endl;
+    }
+}
+
+SockRefclock::~SockRefclock()
+{
+    if (fd_ != -1)
+    {
+        close(fd_);
+    }
+}
+
+bool SockRefclock::connect_socket()
+{
+    if (fd_ == -1)
+    {
+        fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd_ == -1) return false;
+    }
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path_.size() >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    strcpy(addr.sun_path, path_.c_str());
+
+    if (connect(fd_, (sockaddr*)&addr, sizeof(addr)) == -1)
+    {
+        // Start from a fresh socket next time.
+        int savedErrno = errno;
+        close(fd_);
+        fd_ = -1;
+        errno = savedErrno;
+        return false;
+    }
+
+    return true;
+}
+
+void SockRefclock::send(const RefclockSample& sample)
+{
+    SockSample sockSample = {};
+    sockSample.tv.tv_sec = sample.receiveTime.tv_sec;
+    sockSample.tv.tv_usec = sample.receiveTime.tv_nsec / 1000;
+    sockSample.offset =
+        (sample.clockTime.tv_sec - sample.receiveTime.tv_sec) +
+        (sample.clockTime.tv_nsec - (sockSample.tv.tv_usec * 1000)) * 1e-9;
+    sockSample.pulse = 0;
+    sockSample.leap = sample.leap;
+    sockSample.magic = SOCK_MAGIC;
+
+    // A datagram either goes out whole right away or not at all.
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        if (fd_ == -1 && !connect_socket())
+        {
+            break;
+        }
+
+        if (::send(fd_, &sockSample, sizeof(sockSample), MSG_DONTWAIT | MSG_NOSIGNAL) == sizeof(sockSample))
+        {
+            samplesSent_++;
+            return;
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            // chrony is behind; don't wait for it.
+            break;
+        }
+
+        // chrony restarted (stale socket) or went away. Reconnect once.
+        close(fd_);
+        fd_ = -1;
+    }
+
+    samplesDropped_++;
+}
@@ -0,0 +1,126 @@
+#ifndef _REFCLOCK_H
+#define _REFCLOCK_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+//=========================================================
+// Outputs for handing decoded time to ntpd or chrony. Each
+// sample pairs the time WWV says it is with the host time at
+// which that moment was received. Drivers are called from
+// the DSP loop, so they must never block: a sample that
+// can't be delivered right away is dropped and counted.
+//=========================================================
+enum LeapIndicator
+{
+    LEAP_NONE = 0,
+    LEAP_INSERT = 1,
+    LEAP_DELETE = 2,
+};
+
+struct RefclockSample
+{
+    timespec clockTime;   // UTC according to the station
+    timespec receiveTime; // host CLOCK_REALTIME when that moment was received
+    LeapIndicator leap;
+    int precision;        // log2 seconds
+};
+
+class RefclockDriver
+{
+public:
+    virtual ~RefclockDriver() = default;
+
+    virtual void send(const RefclockSample& sample) = 0;
+
+    virtual const char* name() const = 0;
+
+    uint64_t samples_sent() const { return samplesSent_; }
+    uint64_t samples_dropped() const { return samplesDropped_; }
+
+protected:
+    uint64_t samplesSent_ = 0;
+    uint64_t samplesDropped_ = 0;
+};
+
+//=========================================================
+// ntpd/chrony shared memory refclock (ntpd's "SHM" driver,
+// chrony's "refclock SHM"). Unit N is the SysV segment with
+// key 0x4e545030 + N; units 0 and 1 are only accessible to
+// root. Samples are written with the count/valid protocol
+// (mode 1) so the reader can detect a torn read.
+//=========================================================
+class ShmRefclock : public RefclockDriver
+{
+public:
+    explicit ShmRefclock(int unit);
+    ~ShmRefclock() override;
+
+    // False if the segment couldn't be created or attached.
+    bool is_open() const { return shm_ != nullptr; }
+
+    void send(const RefclockSample& sample) override;
+    const char* name() const override { return "shm"; }
+
+    // Layout shared with ntpd's refclock_shm.c and chrony's
+    // refclock_shm.c.
+    struct ShmTime
+    {
+        int mode;
+        volatile int count;
+        time_t clockTimeStampSec;
+        int clockTimeStampUSec;
+        time_t receiveTimeStampSec;
+        int receiveTimeStampUSec;
+        int leap;
+        int precision;
+        int nsamples;
+        volatile int valid;
+        unsigned clockTimeStampNSec;
+        unsigned receiveTimeStampNSec;
+        int dummy[8];
+    };
+
+    static const int SHM_KEY_BASE = 0x4e545030;
+
+private:
+    ShmTime* shm_;
+};
+
+//=========================================================
+// chrony SOCK refclock ("refclock SOCK /path"). chrony owns
+// the Unix datagram socket; we connect to it and send one
+// sock_sample per marker. If chrony isn't listening the
+// sample is dropped and we try to connect again next time.
+//=========================================================
+class SockRefclock : public RefclockDriver
+{
+public:
+    explicit SockRefclock(const std::string& path);
+    ~SockRefclock() override;
+
+    void send(const RefclockSample& sample) override;
+    const char* name() const override { return "sock"; }
+
+    // Layout shared with chrony's refclock_sock.c.
+    struct SockSample
+    {
+        struct timeval tv;
+        double offset;
+        int pulse;
+        int leap;
+        int _pad;
+        int magic;
+    };
+
+    static const int SOCK_MAGIC = 0x534f434b;
+
+private:
+    std::string path_;
+    int fd_;
+
+    bool connect_socket();
+};
+
+#endif // _REFCLOCK_H
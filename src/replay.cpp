@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fir.h"
+#include "input.h"
+#include "replay.h"
+
+Replay::Replay(const DecoderOptions& decoderOptions, const ReplayOptions& options)
+    : decoderOptions_(decoderOptions)
+    , options_(options)
+{
+    // Nothing else to do.
+}
+
+bool Replay::run(const std::vector<std::string>& paths, std::ostream& out)
+{
+    auto started = std::chrono::steady_clock::now();
+    enableFlushToZero();
+
+    std::vector<Recording> recordings(paths.size());
+    bool ok = true;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        recordings[i].path = paths[i];
+        ok = open_recording(recordings[i]) && ok;
+        split(recordings[i]);
+    }
+
+    // Every segment of every recording goes in one queue.
+    std::vector<std::pair<size_t, size_t>> queue;
+    double duration = 0;
+    for (size_t i = 0; i < recordings.size(); i++)
+    {
+        for (size_t k = 0; k < recordings[i].segments.size(); k++)
+        {
+            queue.push_back({i, k});
+        }
+        duration += (double)recordings[i].numSamples / INPUT_SAMPLE_RATE;
+    }
+
+    unsigned jobs = options_.jobs > 0 ? options_.jobs : std::max(std::thread::hardware_concurrency(), 1u);
+    jobs = std::max<size_t>(std::min<size_t>(jobs, queue.size()), 1);
+
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        enableFlushToZero();
+        for (size_t j; (j = next++) < queue.size();)
+        {
+            Recording& recording = recordings[queue[j].first];
+            decode(recording.samples, recording.segments[queue[j].second]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < jobs; i++)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    size_t numRedone = 0;
+    for (Recording& recording : recordings)
+    {
+        if (recording.samples == nullptr) continue;
+
+        std::vector<Event> log;
+        numRedone += stitch(recording, log);
+        if (recordings.size() > 1)
+        {
+            out << "# " << recording.path << '\n';
+        }
+        write_log(log, out);
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cerr << "Replayed " << std::fixed << std::setprecision(1) << (duration / 3600) << " hours in "
+              << elapsed << " s (" << std::setprecision(0) << (duration / elapsed) << "x real time) on "
+              << jobs << " threads, " << queue.size() << " segments, " << numRedone << " redone"
+              << std::defaultfloat << std::endl;
+    return ok;
+}
+
+bool Replay::open_recording(Recording& recording) const
+{
+    recording.samples = nullptr;
+    recording.numSamples = 0;
+
+    int fd = open(recording.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        std::cerr << recording.path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // The mapping outlives the descriptor.
+    recording.reader = std::make_unique<SampleReader>(fd);
+    close(fd);
+
+    recording.samples = recording.reader->mapped_samples(recording.numSamples);
+    if (recording.samples == nullptr)
+    {
+        std::cerr << recording.path << ": can't replay, not a regular file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Replay::split(Recording& recording) const
+{
+    if (recording.samples == nullptr)
+    {
+        return;
+    }
+
+    // Segments are at least as long as the overlap so that only
+    // neighbours ever overlap.
+    uint64_t overlap = (uint64_t)OVERLAP_MINUTES * 60 * INPUT_SAMPLE_RATE;
+    uint64_t segmentSamples = (uint64_t)std::max(options_.segmentMinutes, OVERLAP_MINUTES) * 60 * INPUT_SAMPLE_RATE;
+    size_t numSegments = options_.segmentMinutes > 0 ? std::max<size_t>(recording.numSamples / segmentSamples, 1) : 1;
+
+    recording.segments.resize(numSegments);
+    for (size_t k = 0; k < numSegments; k++)
+    {
+        Segment& segment = recording.segments[k];
+        segment.begin = k * segmentSamples;
+        segment.end = k + 1 == numSegments ? recording.numSamples : (k + 1) * segmentSamples;
+        segment.decodeBegin = segment.begin > overlap ? segment.begin - overlap : 0;
+        segment.decodeEnd = std::min<uint64_t>(segment.end + overlap, recording.numSamples);
+    }
+}
+
+// Puts the segments' events together, from the first event each one
+// is responsible for (start) to the seam with the next one. Returns
+// how many segments had to be decoded again.
+size_t Replay::stitch(Recording& recording, std::vector<Event>& log) const
+{
+    std::vector<Segment>& segments = recording.segments;
+    size_t start = 0;
+    size_t numRedone = 0;
+    size_t k = 0;
+    while (k + 1 < segments.size())
+    {
+        Segment& earlier = segments[k];
+        const Segment& later = segments[k + 1];
+
+        size_t earlierEnd = 0, laterBegin = 0;
+        if (find_seam(earlier, later, earlierEnd, laterBegin))
+        {
+            log.insert(log.end(), earlier.events.begin() + start, earlier.events.begin() + std::max(start, earlierEnd));
+            start = laterBegin;
+            k++;
+            continue;
+        }
+
+        // Decoding the same samples from the same place gives the
+        // same events, so start still points at the right one.
+        earlier.end = later.end;
+        earlier.decodeEnd = later.decodeEnd;
+        segments.erase(segments.begin() + k + 1);
+        decode(recording.samples, earlier);
+        numRedone++;
+    }
+    log.insert(log.end(), segments[k].events.begin() + start, segments[k].events.end());
+    return numRedone;
+}
+
+void Replay::decode(const int16_t* samples, Segment& segment) const
+{
+    // Nothing but the events is wanted.
+    std::ostream discard(nullptr);
+    WwvDecoder decoder(decoderOptions_, discard, [](const DecodedMinute&) {});
+
+    uint64_t offset = segment.decodeBegin;
+    segment.events.clear();
+    decoder.set_event_handler([&segment, offset](const DecoderEvent& event) {
+        std::ostringstream text;
+        switch (event.kind)
+        {
+            case DecoderEvent::LOCK:
+                text << "lock";
+                break;
+            case DecoderEvent::SYMBOL:
+                text << event.symbol;
+                break;
+            case DecoderEvent::TIME_CODE:
+            {
+                const TimeCode& timeCode = event.minute.timeCode;
+                text << "time " << timeCode.year << "." << std::setfill('0') << std::setw(3) << timeCode.dayOfYear
+                     << " " << std::setw(2) << timeCode.hour << ":" << std::setw(2) << timeCode.minute;
+                if (event.minute.onTimeSample >= 0)
+                {
+                    text << " marker " << std::fixed << std::setprecision(2) << (offset + event.minute.onTimeSample)
+                         << (event.minute.station == WWV ? " wwv" : " wwvh");
+                }
+                break;
+            }
+            case DecoderEvent::LOSS:
+                text << "loss " << event.lostDuring;
+                break;
+        }
+        segment.events.push_back({offset + event.sample, event.kind, text.str()});
+    });
+
+    decoder.process(samples + segment.decodeBegin, segment.decodeEnd - segment.decodeBegin);
+}
+
+// Looks for where the two decoders start agreeing for good before
+// the end of the earlier one: the longest run of identical events
+// that ends the overlap on both sides. Returns false if there's no
+// such run even though something happened there.
+bool Replay::find_seam(const Segment& earlier, const Segment& later, size_t& earlierEnd, size_t& laterBegin) const
+{
+    uint64_t from = later.begin;
+    uint64_t to = earlier.decodeEnd - std::min<uint64_t>(earlier.decodeEnd, (uint64_t)GUARD_SECONDS * INPUT_SAMPLE_RATE);
+
+    auto inOverlap = [from, to](const std::vector<Event>& events, std::vector<size_t>& indices) {
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            if (events[i].sample >= from && events[i].sample < to) indices.push_back(i);
+        }
+    };
+
+    std::vector<size_t> a, b;
+    inOverlap(earlier.events, a);
+    inOverlap(later.events, b);
+
+    size_t common = 0;
+    while (common < a.size() && common < b.size() &&
+           earlier.events[a[a.size() - 1 - common]] == later.events[b[b.size() - 1 - common]])
+    {
+        common++;
+    }
+
+    if (common > 0)
+    {
+        earlierEnd = a[a.size() - common];
+        laterBegin = b[b.size() - common];
+        return true;
+    }
+
+    if (!a.empty() || !b.empty())
+    {
+        return false;
+    }
+
+    // Neither decoder did anything there, so switch over at the end.
+    auto firstAfter = [to](const std::vector<Event>& events) {
+        size_t i = 0;
+        while (i < events.size() && events[i].sample < to) i++;
+        return i;
+    };
+    earlierEnd = firstAfter(earlier.events);
+    laterBegin = firstAfter(later.events);
+    return true;
+}
+
+// One line per event, except that a minute's symbols share a
+// line starting at its R.
+void Replay::write_log(const std::vector<Event>& events, std::ostream& out) const
+{
+    bool inSymbols = false;
+    for (const Event& event : events)
+    {
+        if (event.kind == DecoderEvent::SYMBOL)
+        {
+            if (!inSymbols || event.text == "R")
+            {
+                if (inSymbols) out << '\n';
+                out << event.sample << " symbols ";
+                inSymbols = true;
+            }
+            out << event.text;
+            continue;
+        }
+
+        if (inSymbols)
+        {
+            out << '\n';
+            inSymbols = false;
+        }
+        out << event.sample << ' ' << event.text << '\n';
+    }
+
+    if (inSymbols)
+    {
+        out << '\n';
+    }
+    out << std::flush;
+}
@@ -0,0 +1,111 @@
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "decoder.h"
+#include "input.h"
+
+struct ReplayOptions
+{
+    // Worker threads, 0 for one per core.
+    unsigned jobs = 0;
+
+    // Split recordings into segments of about this many minutes
+    // (at least OVERLAP_MINUTES), 0 to decode each one whole.
+    int segmentMinutes = 0;
+};
+
+//=========================================================
+// Decodes recordings as fast as the cores allow and writes
+// a compact log of what the decoder did (lock, symbols,
+// time codes, loss of sync) by input sample, e.g. to find
+// out why a long unattended run lost lock.
+//
+// Files are memory mapped and handed out to worker threads,
+// each with its own decoder, so with several recordings the
+// log is exactly what decoding them one by one would give.
+//
+// A single long recording can also be split into segments
+// that are decoded in parallel. Every decoder then starts
+// OVERLAP_MINUTES early to lock on (longer than the voting
+// accumulator's memory) and runs OVERLAP_MINUTES into the
+// next segment. Where two segments meet, the last events
+// of the overlap have to be the same from both decoders, and
+// the log switches from one to the other where that agreement
+// begins. If they don't agree at all, the earlier segment is
+// decoded again through the end of the later one. The
+// decoder's running averages never quite forget where they
+// started, though, so where the signal is marginal a symbol
+// edge can still come out a sample or two away from where a
+// single pass would have put it.
+//=========================================================
+class Replay
+{
+public:
+    static const int OVERLAP_MINUTES = 10;
+
+    Replay(const DecoderOptions& decoderOptions, const ReplayOptions& options);
+
+    // Decodes 16 bit mono recordings and writes their event logs
+    // to out, in order. Returns false (and says why on stderr) if
+    // any of them couldn't be mapped.
+    bool run(const std::vector<std::string>& paths, std::ostream& out);
+
+private:
+    // Events don't come out until up to a symbol after where they
+    // happened, so a segment's last GUARD_SECONDS are left out of
+    // the comparison at the seam.
+    static const int GUARD_SECONDS = 5;
+
+    struct Event
+    {
+        uint64_t sample;
+        DecoderEvent::Kind kind;
+        std::string text;
+
+        bool operator==(const Event& other) const
+        {
+            return sample == other.sample && kind == other.kind && text == other.text;
+        }
+    };
+
+    struct Segment
+    {
+        // Events from [begin, end) go into the log.
+        uint64_t begin;
+        uint64_t end;
+
+        // What was actually decoded.
+        uint64_t decodeBegin;
+        uint64_t decodeEnd;
+
+        std::vector<Event> events;
+    };
+
+    struct Recording
+    {
+        std::string path;
+        std::unique_ptr<SampleReader> reader;
+        const int16_t* samples;
+        size_t numSamples;
+        std::vector<Segment> segments;
+    };
+
+    DecoderOptions decoderOptions_;
+    ReplayOptions options_;
+
+    bool open_recording(Recording& recording) const;
+    void split(Recording& recording) const;
+    void decode(const int16_t* samples, Segment& segment) const;
+    size_t stitch(Recording& recording, std::vector<Event>& log) const;
+    bool find_seam(const Segment& earlier, const Segment& later, size_t& earlierEnd, size_t& laterBegin) const;
+    void write_log(const std::vector<Event>& events, std::ostream& out) const;
+};
+
+#endif // _REPLAY_H
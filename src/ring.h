@@ -0,0 +1,52 @@
+#ifndef _RING_H
+#define _RING_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+
+//=========================================================
+// Fixed-capacity FIFO with deque-like access. Storage lives
+// inside the object (capacity rounded up to a power of two)
+// so nothing is allocated once it's constructed. Pushing 
+// into a full ring drops the oldest element.
+//=========================================================
+template <typename T, size_t Capacity>
+class FixedRing
+{
+public:
+    static constexpr size_t CAPACITY = std::bit_ceil(Capacity);
+    
+    size_t size() const { return tail_ - head_; }
+    bool empty() const { return tail_ == head_; }
+    bool full() const { return size() == CAPACITY; }
+    
+    T& operator[](size_t index) { return items_[(head_ + index) & MASK]; }
+    const T& operator[](size_t index) const { return items_[(head_ + index) & MASK]; }
+    
+    T& front() { return (*this)[0]; }
+    T& back() { return (*this)[size() - 1]; }
+    
+    void push_back(const T& item)
+    {
+        if (full()) head_++;
+        items_[tail_ & MASK] = item;
+        tail_++;
+    }
+    
+    void pop_front(size_t count = 1)
+    {
+        head_ += count < size() ? count : size();
+    }
+    
+    void clear() { head_ = tail_ = 0; }
+    
+private:
+    static constexpr size_t MASK = CAPACITY - 1;
+    
+    std::array<T, CAPACITY> items_ = {};
+    size_t head_ = 0;
+    size_t tail_ = 0;
+};
+
+#endif // _RING_H
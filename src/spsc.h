@@ -0,0 +1,124 @@
+#ifndef _SPSC_H
+#define _SPSC_H
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//=========================================================
+// Lock-free ring between exactly one producer thread and one
+// consumer thread. Items are written and read in place, so
+// large blocks are never copied: the producer fills the slot
+// from write_slot() and publishes it with commit(), and the
+// consumer reads the slot from read_slot() and hands it back
+// with release(). Either side can also sleep until the other
+// has done something (std::atomic wait/notify, which is a
+// futex on Linux and costs nothing while nobody is waiting).
+//=========================================================
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(size_t capacity)
+        : capacity_(std::bit_ceil(capacity))
+        , items_(new T[capacity_])
+    {
+        // Nothing else to do.
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Producer side. write_slot() returns nullptr if the ring is full.
+    T* write_slot()
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == capacity_)
+        {
+            return nullptr;
+        }
+        return &items_[tail & (capacity_ - 1)];
+    }
+
+    void commit()
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        signal(written_);
+    }
+
+    // Waits for a free slot.
+    T* wait_write_slot()
+    {
+        for (;;)
+        {
+            uint32_t seen = read_.load(std::memory_order_acquire);
+            if (T* slot = write_slot()) return slot;
+            read_.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    // No more items will be written.
+    void close()
+    {
+        closed_.store(true, std::memory_order_release);
+        signal(written_);
+    }
+
+    // Consumer side. read_slot() returns nullptr if the ring is empty.
+    T* read_slot()
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (tail_.load(std::memory_order_acquire) == head)
+        {
+            return nullptr;
+        }
+        return &items_[head & (capacity_ - 1)];
+    }
+
+    void release()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        signal(read_);
+    }
+
+    // Waits for an item. Returns nullptr once the ring has been
+    // closed and everything in it has been read.
+    T* wait_read_slot()
+    {
+        for (;;)
+        {
+            uint32_t seen = written_.load(std::memory_order_acquire);
+            if (T* slot = read_slot()) return slot;
+            if (closed_.load(std::memory_order_acquire)) return read_slot();
+            written_.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+private:
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    static void signal(std::atomic<uint32_t>& counter)
+    {
+        counter.fetch_add(1, std::memory_order_release);
+        counter.notify_one();
+    }
+
+    size_t capacity_;
+    std::unique_ptr<T[]> items_;
+
+    // Each side's index gets its own cache line so the two threads
+    // don't keep taking it from each other.
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+
+    // Bumped on every commit()/close() and release(), for the
+    // other side to wait on.
+    alignas(64) std::atomic<uint32_t> written_{0};
+    alignas(64) std::atomic<uint32_t> read_{0};
+
+    std::atomic<bool> closed_{false};
+};
+
+#endif // _SPSC_H
@@ -0,0 +1,59 @@
+#ifndef _SYMBOLS_H
+#define _SYMBOLS_H
+
+#include "carriers.h"
+
+//=========================================================
+// The possible "characters" WWV/WWVH can send using the 
+// 100 Hz subcarrier.
+//
+// Each character is the carrier being present for some
+// time followed by a gap until the next one starts. Like
+// the decoder, characters are defined beginning from when 
+// the carrier becomes high (30ms after the start of the
+// second) until when the next one should be present. The
+// sample patterns are generated at compile time for the
+// given sample rate.
+//=========================================================
+template <int SampleRate, int OnMs, int OffMs>
+struct Symbol
+{
+    static_assert((SampleRate * OnMs) % 1000 == 0 && (SampleRate * OffMs) % 1000 == 0,
+                  "symbol durations must be a whole number of samples");
+    
+    static constexpr size_t ON_SAMPLES = (size_t)SampleRate * OnMs / 1000;
+    static constexpr size_t OFF_SAMPLES = (size_t)SampleRate * OffMs / 1000;
+    static constexpr size_t LENGTH = ON_SAMPLES + OFF_SAMPLES;
+    
+    static constexpr PackedPattern<LENGTH> PATTERN = PackedPattern<LENGTH>(ON_SAMPLES);
+    
+    static constexpr RunLengthCorrelator correlator()
+    {
+        return RunLengthCorrelator(ON_SAMPLES, OFF_SAMPLES);
+    }
+};
+
+template <int SampleRate>
+struct WwvSymbols
+{
+    // 0.770s position identifier (P0) plus 0.200s so that the 
+    // hole starts at the next second exactly (1.000 - 0.030 - 0.770),
+    // then the 1.030s "hole".
+    typedef Symbol<SampleRate, 770, 200 + 1030> ReferenceMarker;
+    
+    // 0.770s position identifier (P1-P5), 0.230s gap before 
+    // next character.
+    typedef Symbol<SampleRate, 770, 230> PositionMarker;
+    
+    // 0.470s identifier, 0.530s gap before next character.
+    typedef Symbol<SampleRate, 470, 530> OneBit;
+    
+    // 0.170s identifier, 0.830s gap before next character.
+    typedef Symbol<SampleRate, 170, 830> ZeroBit;
+    
+    // Longest character, i.e. how much carrier history the
+    // decoder needs to keep.
+    static constexpr size_t MAX_LENGTH = ReferenceMarker::LENGTH;
+};
+
+#endif // _SYMBOLS_H
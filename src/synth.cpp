@@ -0,0 +1,258 @@
+#include <algorithm>
+
+#include "decoder.h"
+#include "symbols.h"
+#include "synth.h"
+
+namespace
+{
+
+// Symbol timings in milliseconds.
+typedef WwvSymbols<1000> Milliseconds;
+
+// Audio level of 100% modulation, the same as IqDemodulator's.
+const float FULL_SCALE = 16384;
+
+// Modulation of each part of the signal.
+const float TICK_LEVEL = 1.0;
+const float TONE_LEVEL = 0.5;
+const float TIME_CODE_LEVEL = 0.18;
+
+const double TICK_SECONDS = 0.005;
+const double MARKER_SECONDS = 0.8;
+
+// Tones are off for 10ms before and 30ms after each second
+// (the tick's protected zone), and only sent in seconds 1-44.
+const double TONE_START = 0.030;
+const double TONE_END = 0.990;
+const int TONE_LAST_SECOND = 44;
+
+const double QRN_TIME_CONSTANT = 0.002;
+
+// Fading changes slowly enough to only work out the gain
+// every so many samples.
+const uint64_t FADING_STEP = 8;
+
+float tone(double frequency, double t)
+{
+    return sin(2 * M_PI * frequency * t);
+}
+
+double toneFrequency(Station station, const TimeCode& timeCode)
+{
+    // No tone while the stations identify themselves.
+    int minute = timeCode.minute;
+    if (minute == 0 || minute == 29 || minute == 30 || minute == 59)
+    {
+        return 0;
+    }
+
+    if (station == WWV)
+    {
+        if (minute == 2 && timeCode.hour != 0) return 440;
+        return minute % 2 == 0 ? 500 : 600;
+    }
+
+    if (minute == 1 && timeCode.hour != 0) return 440;
+    return minute % 2 == 0 ? 600 : 500;
+}
+
+}
+
+void buildTimeCodeFrame(const TimeCode& timeCode, char (&frame)[TIMECODE_LENGTH])
+{
+    std::fill(frame, frame + TIMECODE_LENGTH, '0');
+    frame[0] = 'R';
+    for (size_t i = 9; i < TIMECODE_LENGTH; i += 10)
+    {
+        frame[i] = 'P';
+    }
+
+    encodeTimeCode(timeCode, frame);
+    frame[LEAP_SECOND_WARNING_BIT] = timeCode.leapSecondWarning ? '1' : '0';
+}
+
+double timeCodePulseEnd(const char (&frame)[TIMECODE_LENGTH], int second)
+{
+    // Second 59 is P0, which together with the silent second 0
+    // makes up the reference marker.
+    size_t onMs;
+    if (second == 59) onMs = Milliseconds::PositionMarker::ON_SAMPLES;
+    else if (second == 0) return 0;
+    else if (frame[second] == 'P') onMs = Milliseconds::PositionMarker::ON_SAMPLES;
+    else if (frame[second] == '1') onMs = Milliseconds::OneBit::ON_SAMPLES;
+    else onMs = Milliseconds::ZeroBit::ON_SAMPLES;
+
+    return TIME_CODE_START + onMs / 1000.0;
+}
+
+void WwvSynthesizer::Fading::init(std::mt19937& random, double dopplerSpread)
+{
+    // Clarke's model: paths arriving from all directions, each
+    // Doppler shifted by the cosine of its angle.
+    std::uniform_real_distribution<double> angle(0, 2 * M_PI);
+    for (int i = 0; i < NUM_PATHS; i++)
+    {
+        frequency[i] = dopplerSpread * cos(angle(random));
+        phase[i] = angle(random);
+    }
+}
+
+float WwvSynthesizer::Fading::gain(double t) const
+{
+    double inPhase = 0, quadrature = 0;
+    for (int i = 0; i < NUM_PATHS; i++)
+    {
+        double theta = 2 * M_PI * frequency[i] * t + phase[i];
+        inPhase += cos(theta);
+        quadrature += sin(theta);
+    }
+
+    // Unit power on average.
+    return sqrt((inPhase * inPhase + quadrature * quadrature) / NUM_PATHS);
+}
+
+WwvSynthesizer::WwvSynthesizer(const SynthOptions& options)
+    : options_(options)
+    , samplePeriod_(1.0 / (INPUT_SAMPLE_RATE * (1 + options.clockPpm / 1e6)))
+    , position_(0)
+    , random_(options.seed)
+    , gaussian_(0, 1)
+    , uniform_(0, 1)
+    , noiseLevel_(0)
+    , qrnAmplitude_(0)
+    , qrnDecay_(exp(-samplePeriod_ / QRN_TIME_CONSTANT))
+    , fadingGain_{1, 1}
+{
+    transmitters_[0].station = WWV;
+    transmitters_[0].level = options_.wwvLevel;
+    transmitters_[0].delay = options_.wwvDelay;
+    transmitters_[1].station = WWVH;
+    transmitters_[1].level = options_.wwvhLevel;
+    transmitters_[1].delay = options_.wwvhDelay;
+
+    for (Transmitter& transmitter : transmitters_)
+    {
+        transmitter.fading.init(random_, options_.fadingRate);
+        transmitter.minute = 0;
+        transmitter.timeCode = options_.start;
+        buildTimeCodeFrame(transmitter.timeCode, transmitter.frame);
+    }
+
+    if (std::isfinite(options_.snr))
+    {
+        // A sine's power is half its amplitude squared.
+        noiseLevel_ = TIME_CODE_LEVEL / sqrt(2) * pow(10, -options_.snr / 20);
+    }
+}
+
+double WwvSynthesizer::minute_sample(Station station, int minute) const
+{
+    const Transmitter& transmitter = transmitters_[station == WWV ? 0 : 1];
+    return (60.0 * minute + transmitter.delay - options_.startSecond) / samplePeriod_;
+}
+
+TimeCode WwvSynthesizer::minute_time_code(int minute) const
+{
+    TimeCode timeCode = options_.start;
+    for (int i = 0; i < minute; i++)
+    {
+        timeCode = nextMinute(timeCode);
+    }
+    return timeCode;
+}
+
+void WwvSynthesizer::generate(int16_t* out, size_t count)
+{
+    for (size_t k = 0; k < count; k++, position_++)
+    {
+        double t = options_.startSecond + position_ * samplePeriod_;
+
+        float x = 0;
+        for (int i = 0; i < 2; i++)
+        {
+            Transmitter& transmitter = transmitters_[i];
+            if (transmitter.level <= 0) continue;
+
+            if (options_.fadingRate > 0 && position_ % FADING_STEP == 0)
+            {
+                fadingGain_[i] = transmitter.fading.gain(t);
+            }
+            x += transmitter.level * fadingGain_[i] * modulation(transmitter, t - transmitter.delay);
+        }
+
+        if (noiseLevel_ > 0)
+        {
+            x += noiseLevel_ * gaussian_(random_);
+        }
+
+        if (options_.qrnRate > 0)
+        {
+            if (uniform_(random_) < options_.qrnRate * samplePeriod_)
+            {
+                qrnAmplitude_ = options_.qrnLevel * uniform_(random_);
+            }
+            x += qrnAmplitude_ * gaussian_(random_);
+            qrnAmplitude_ *= qrnDecay_;
+        }
+
+        out[k] = (int16_t)std::clamp(x * FULL_SCALE, -32767.0f, 32767.0f);
+    }
+}
+
+float WwvSynthesizer::modulation(Transmitter& transmitter, double t)
+{
+    // Nothing is sent before the first minute.
+    if (t < 0)
+    {
+        return 0;
+    }
+
+    int minute = (int)(t / 60);
+    if (minute != transmitter.minute)
+    {
+        transmitter.timeCode = minute == transmitter.minute + 1 ? nextMinute(transmitter.timeCode)
+                                                                : minute_time_code(minute);
+        transmitter.minute = minute;
+        buildTimeCodeFrame(transmitter.timeCode, transmitter.frame);
+    }
+
+    double intoMinute = t - 60.0 * minute;
+    int second = std::min((int)intoMinute, 59);
+    double f = intoMinute - second;
+
+    float value = 0;
+
+    if (f >= TIME_CODE_START && f < timeCodePulseEnd(transmitter.frame, second))
+    {
+        value += TIME_CODE_LEVEL * tone(100, f);
+    }
+
+    double tickFrequency = transmitter.station == WWV ? 1000 : 1200;
+    if (second == 0)
+    {
+        // Minute marker, or the hour marker at the top of the hour.
+        double frequency = transmitter.timeCode.minute == 0 ? 1500 : tickFrequency;
+        if (f < MARKER_SECONDS) value += TICK_LEVEL * tone(frequency, f);
+    }
+    else if (second != 29 && second != 59 && f < TICK_SECONDS)
+    {
+        value += TICK_LEVEL * tone(tickFrequency, f);
+    }
+
+    if (options_.tones && second >= 1 && second <= TONE_LAST_SECOND && f >= TONE_START && f < TONE_END)
+    {
+        double frequency = toneFrequency(transmitter.station, transmitter.timeCode);
+        if (frequency > 0) value += TONE_LEVEL * tone(frequency, f);
+    }
+
+    return value;
+}
+
+std::vector<int16_t> synthesize(const SynthOptions& options, int seconds)
+{
+    WwvSynthesizer synthesizer(options);
+    std::vector<int16_t> audio((size_t)seconds * INPUT_SAMPLE_RATE);
+    synthesizer.generate(audio.data(), audio.size());
+    return audio;
+}
@@ -0,0 +1,157 @@
+#ifndef _SYNTH_H
+#define _SYNTH_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "timecode.h"
+#include "tick.h"
+
+struct SynthOptions
+{
+    // Time code of the first minute, and how far into it the
+    // output starts (seconds).
+    TimeCode start = {2023, 207, 2, 0, false};
+    double startSecond = 0;
+
+    // Amplitude of each station relative to a full strength one
+    // (0 = not received), and how long its signal takes to get
+    // here (seconds).
+    double wwvLevel = 1;
+    double wwvhLevel = 0;
+    double wwvDelay = 0;
+    double wwvhDelay = 0;
+
+    // The 440/500/600 Hz tones between the ticks.
+    bool tones = true;
+
+    // White noise over the whole audio band: power of a full
+    // strength station's 100 Hz subcarrier over the noise power,
+    // in dB. Infinite = no noise.
+    double snr = INFINITY;
+
+    // Rayleigh fading with this Doppler spread (Hz), independently
+    // for each station. 0 = steady signals.
+    double fadingRate = 0;
+
+    // Static crashes: average number per second, and the peak
+    // level of the loudest relative to 100% modulation.
+    double qrnRate = 0;
+    double qrnLevel = 2;
+
+    // How fast the receiving sound card's clock runs, in parts
+    // per million: it takes INPUT_SAMPLE_RATE * (1 + ppm / 1e6)
+    // samples per real second.
+    double clockPpm = 0;
+
+    // Noise, fading and static are the same for the same seed.
+    unsigned seed = 1;
+};
+
+// Symbols of a minute's time code: R, then P at the position
+// markers and 1 or 0 in between (see timecode.h). Only the
+// date, time and leap second warning are encoded; DST and UT1
+// are left at 0.
+void buildTimeCodeFrame(const TimeCode& timeCode, char (&frame)[TIMECODE_LENGTH]);
+
+// When the 100 Hz subcarrier goes off in the given second of a
+// minute with the given frame (seconds from the start of the
+// second, 0 if it's never on). It comes on TIME_CODE_START in.
+double timeCodePulseEnd(const char (&frame)[TIMECODE_LENGTH], int second);
+
+const double TIME_CODE_START = 0.030;
+
+//=========================================================
+// Generates what a receiver tuned to WWV and/or WWVH would
+// put out: 16 bit mono audio at INPUT_SAMPLE_RATE carrying
+// the time code on the 100 Hz subcarrier, the second ticks,
+// minute and hour markers and (optionally) the tones, with
+// noise, fading, static and a sound card clock that's off
+// by a given amount on top.
+//
+// The broadcast format is simplified to what matters to the
+// decoder: WWV's tones alternate between 500 and 600 Hz by
+// minute (WWVH's the other way round) with 440 Hz once an
+// hour, and there are no voice announcements.
+//
+// Every sample is computed from the time it's taken at, so
+// output is exactly reproducible, can start anywhere, and
+// the clock offset costs nothing. An hour takes a few
+// seconds to generate.
+//=========================================================
+class WwvSynthesizer
+{
+public:
+    explicit WwvSynthesizer(const SynthOptions& options);
+
+    // Writes the next count samples.
+    void generate(int16_t* out, size_t count);
+
+    // Samples generated so far.
+    uint64_t position() const { return position_; }
+
+    // Output sample (possibly fractional, counted from the first
+    // one) at which the given station's minute (counted from the
+    // first, which is minute 0) begins. Negative if it began
+    // before the output did.
+    double minute_sample(Station station, int minute) const;
+
+    // Time code of the given minute (counted from the first).
+    TimeCode minute_time_code(int minute) const;
+
+private:
+    struct Fading
+    {
+        static const int NUM_PATHS = 8;
+
+        double frequency[NUM_PATHS];
+        double phase[NUM_PATHS];
+
+        void init(std::mt19937& random, double dopplerSpread);
+        float gain(double t) const;
+    };
+
+    struct Transmitter
+    {
+        Station station;
+        double level;
+        double delay;
+        Fading fading;
+
+        // Frame of the last minute asked for.
+        int minute;
+        char frame[TIMECODE_LENGTH];
+        TimeCode timeCode;
+    };
+
+    SynthOptions options_;
+    double samplePeriod_;
+    uint64_t position_;
+
+    Transmitter transmitters_[2];
+
+    std::mt19937 random_;
+    std::normal_distribution<float> gaussian_;
+    std::uniform_real_distribution<float> uniform_;
+    float noiseLevel_;
+
+    // Static crash in progress.
+    float qrnAmplitude_;
+    float qrnDecay_;
+
+    // Each transmitter's fading, as of the last FADING_STEP.
+    float fadingGain_[2];
+
+    // Modulation of a transmitter at time t since the start of
+    // the first minute (as sent, before any delay).
+    float modulation(Transmitter& transmitter, double t);
+};
+
+// The given number of seconds of what WwvSynthesizer puts out
+// with the given options, all at once (for tests and benchmarks).
+std::vector<int16_t> synthesize(const SynthOptions& options, int seconds);
+
+#endif // _SYNTH_H
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+
+#include "tick.h"
+
+namespace
+{
+
+const double WWV_TICK_FREQUENCY = 1000;
+const double WWVH_TICK_FREQUENCY = 1200;
+
+// Ticks have to be this far above the average matched filter output.
+const float MIN_TICK_TO_NOISE = 4;
+
+// And this far above the other frequency's output at the same time.
+const float MIN_TICK_TO_OTHER = 2;
+
+// Ticks are at least half a second apart, unless the second one is
+// this much stronger (the first was a click).
+const float MIN_TICK_TO_CLICK = 2;
+
+// Time constant of the average, in seconds. Ticks are only 0.5% of
+// each second, so they barely move it.
+const double NOISE_TIME_CONSTANT = 1.0;
+
+}
+
+TickDetector::Mixer::Mixer(int sampleRate, double frequency, size_t windowSize)
+    : cosTable(windowSize)
+    , sinTable(windowSize)
+    , inPhaseProducts(windowSize, 0.0f)
+    , quadratureProducts(windowSize, 0.0f)
+{
+    // Both tick frequencies complete a whole number of cycles in
+    // 5ms, so the oscillator can come from a table like in
+    // QuadratureDetector.
+    for (size_t i = 0; i < windowSize; i++)
+    {
+        double angle = 2 * M_PI * frequency * i / sampleRate;
+        cosTable[i] = 2 * cos(angle) / windowSize;
+        sinTable[i] = 2 * sin(angle) / windowSize;
+    }
+}
+
+float TickDetector::Mixer::operator()(float sample, size_t phase)
+{
+    float inPhase = sample * cosTable[phase];
+    float quadrature = sample * sinTable[phase];
+
+    inPhaseSum += inPhase - inPhaseProducts[phase];
+    quadratureSum += quadrature - quadratureProducts[phase];
+    inPhaseProducts[phase] = inPhase;
+    quadratureProducts[phase] = quadrature;
+
+    return sqrt(inPhaseSum * inPhaseSum + quadratureSum * quadratureSum);
+}
+
+TickDetector::Tone::Tone(int sampleRate, double frequency, size_t windowSize)
+    : mixer(sampleRate, frequency, windowSize)
+    , magnitudes(2 * windowSize, 0.0f)
+    , havePeak(false)
+    , peakIndex(0)
+    , peakOffset(0)
+    , lastTickIndex(0)
+    , lastTickPeak(0)
+{
+    // Nothing else to do.
+}
+
+TickDetector::TickDetector(int sampleRate, double tickSeconds)
+    : windowSize_(lround(sampleRate * tickSeconds))
+    , phase_(0)
+    , sampleIndex_(0)
+    , minSpacing_(sampleRate / 2)
+    , warmup_(std::max<uint64_t>(2 * windowSize_, NOISE_TIME_CONSTANT * sampleRate))
+    , tones_{
+        Tone(sampleRate, WWV_TICK_FREQUENCY, windowSize_),
+        Tone(sampleRate, WWVH_TICK_FREQUENCY, windowSize_),
+    }
+    , noiseRise_(1 - exp(-1.0 / (NOISE_TIME_CONSTANT * sampleRate)))
+    , noiseLevel_(0)
+    , ticks_()
+{
+    // Nothing else to do.
+}
+
+size_t TickDetector::operator()(float sample)
+{
+    float wwv = tones_[WWV].mixer(sample, phase_);
+    float wwvh = tones_[WWVH].mixer(sample, phase_);
+    if (++phase_ == windowSize_) phase_ = 0;
+
+    noiseLevel_ += (std::max(wwv, wwvh) - noiseLevel_) * noiseRise_;
+
+    uint64_t index = sampleIndex_++;
+    size_t historySize = 2 * windowSize_;
+    tones_[WWV].magnitudes[index % historySize] = wwv;
+    tones_[WWVH].magnitudes[index % historySize] = wwvh;
+
+    if (index < warmup_)
+    {
+        // Let the noise average settle first.
+        return 0;
+    }
+
+    size_t numTicks = 0;
+    for (Station station : {WWV, WWVH})
+    {
+        if (find_tick(station, index, ticks_[numTicks]))
+        {
+            numTicks++;
+        }
+    }
+    return numTicks;
+}
+
+bool TickDetector::find_tick(Station station, uint64_t index, DetectedTick& tick)
+{
+    Tone& tone = tones_[station];
+    const Tone& other = tones_[station == WWV ? WWVH : WWV];
+
+    size_t historySize = tone.magnitudes.size();
+    auto at = [&](const std::vector<float>& history, uint64_t index)
+    {
+        return history[index % historySize];
+    };
+
+    // Is the previous output a peak? It has to be a local maximum
+    // well above the noise that the filter climbed up to over the
+    // last tick length, and not a click that the other frequency
+    // picked up as well.
+    uint64_t middle = index - 1;
+    float before = at(tone.magnitudes, middle - 1);
+    float peak = at(tone.magnitudes, middle);
+    float after = at(tone.magnitudes, index);
+    if (peak > before && peak >= after &&
+        peak > MIN_TICK_TO_NOISE * noiseLevel_ &&
+        peak > MIN_TICK_TO_OTHER * at(other.magnitudes, middle) &&
+        at(tone.magnitudes, middle - windowSize_) < 0.5f * peak &&
+        (middle - tone.lastTickIndex > minSpacing_ || peak > MIN_TICK_TO_CLICK * tone.lastTickPeak) &&
+        (!tone.havePeak || peak > at(tone.magnitudes, tone.peakIndex)))
+    {
+        // The output is a triangle, so the true peak is where the
+        // rising and falling slopes meet. The steeper-looking side
+        // is the one the peak is closer to.
+        float lower = std::min(before, after);
+        tone.havePeak = true;
+        tone.peakIndex = middle;
+        tone.peakOffset = (after - before) / (2 * (peak - lower));
+    }
+
+    // Confirm once the filter has slid all the way off the tick.
+    // Longer tones will still be there.
+    if (tone.havePeak && index == tone.peakIndex + windowSize_)
+    {
+        tone.havePeak = false;
+
+        float peak = at(tone.magnitudes, tone.peakIndex);
+        if (after < 0.5f * peak)
+        {
+            // At the peak the window (centered (N - 1) / 2 samples
+            // before its newest one) is centered on the tick.
+            double center = tone.peakIndex + tone.peakOffset - (windowSize_ - 1) / 2.0;
+            tick.sample = center - windowSize_ / 2.0;
+            tick.tickToNoise = peak / noiseLevel_;
+            tick.station = station;
+            tone.lastTickIndex = tone.peakIndex;
+            tone.lastTickPeak = peak;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,117 @@
+#ifndef _TICK_H
+#define _TICK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Which station a tick (or a minute's timing) came from; the
+// two differ in their tick frequency.
+enum Station
+{
+    WWV,  // Fort Collins, 1000 Hz ticks
+    WWVH, // Kauai, 1200 Hz ticks
+};
+
+const int NUM_STATIONS = 2;
+
+// A second tick found on the input.
+struct DetectedTick
+{
+    double sample;      // input sample where it began
+    float tickToNoise;
+    Station station;
+};
+
+//=========================================================
+// Finds the 5ms second ticks (1000 Hz from WWV, 1200 Hz from
+// WWVH), tells which station each one came from, and
+// estimates where it started to a fraction of a sample.
+//
+// The input is mixed down at both frequencies and summed
+// over a sliding 5ms window, i.e. a matched filter for the
+// tick (equivalent to a sliding Goertzel filter per
+// frequency). Its magnitude rises linearly while the window
+// slides onto the tick and falls once it slides off, so the
+// peak (where the window lines up with the tick) can be found
+// between samples from the slopes on either side. Tones
+// longer than a tick (e.g. the minute and hour markers)
+// don't fall off afterwards and are ignored.
+//
+// Peaks are looked for at each frequency separately, so when
+// both stations are heard their ticks are found side by side.
+// The two frequencies are a whole number of cycles apart over
+// a tick, so when the window lines up with a tick the other
+// filter hardly sees it. Clicks (e.g. where the tones are cut
+// off ahead of each second) show up in both about equally,
+// so a peak only counts if it's well above the other
+// filter's output. One that still gets through can be
+// followed by the real tick within a few ms, which is found
+// as well if it's much stronger.
+//=========================================================
+class TickDetector
+{
+public:
+    TickDetector(int sampleRate, double tickSeconds = 0.005);
+
+    // Returns the number of ticks (0, or 1 per station) that have
+    // just been confirmed, which is one tick length after their
+    // peak.
+    size_t operator()(float sample);
+
+    // The ticks just confirmed. Samples are counted from the first
+    // one passed in, and tickToNoise is how far the peak was above
+    // the average matched filter output (a ratio of amplitudes).
+    const DetectedTick& tick(size_t i) const { return ticks_[i]; }
+
+private:
+    struct Mixer
+    {
+        std::vector<float> cosTable;
+        std::vector<float> sinTable;
+        std::vector<float> inPhaseProducts;
+        std::vector<float> quadratureProducts;
+        double inPhaseSum = 0;
+        double quadratureSum = 0;
+
+        Mixer(int sampleRate, double frequency, size_t windowSize);
+        float operator()(float sample, size_t phase);
+    };
+
+    struct Tone
+    {
+        Mixer mixer;
+
+        // Matched filter outputs for the last two tick lengths,
+        // indexed by sample index modulo their size.
+        std::vector<float> magnitudes;
+
+        // Peak waiting to be confirmed.
+        bool havePeak;
+        uint64_t peakIndex;
+        float peakOffset;
+        uint64_t lastTickIndex;
+        float lastTickPeak;
+
+        Tone(int sampleRate, double frequency, size_t windowSize);
+    };
+
+    size_t windowSize_;
+    size_t phase_;
+    uint64_t sampleIndex_;
+    uint64_t minSpacing_;
+    uint64_t warmup_;
+
+    // Indexed by Station.
+    Tone tones_[NUM_STATIONS];
+
+    // Average of the larger of the two outputs.
+    float noiseRise_;
+    float noiseLevel_;
+
+    DetectedTick ticks_[NUM_STATIONS];
+
+    bool find_tick(Station station, uint64_t index, DetectedTick& tick);
+};
+
+#endif // _TICK_H
@@ -0,0 +1,53 @@
+#include "timecode.h"
+
+int daysInYear(int year)
+{
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return leap ? 366 : 365;
+}
+
+bool isValid(const TimeCode& timeCode)
+{
+    return 
+        timeCode.minute < 60 && 
+        timeCode.hour < 24 && 
+        timeCode.dayOfYear >= 1 && timeCode.dayOfYear <= daysInYear(timeCode.year);
+}
+
+time_t toUnixTime(const TimeCode& timeCode)
+{
+    // timegm() normalizes day-of-month overflow, so January can
+    // stand in for the whole year.
+    struct tm tm = {};
+    tm.tm_year = timeCode.year - 1900;
+    tm.tm_mon = 0;
+    tm.tm_mday = timeCode.dayOfYear;
+    tm.tm_hour = timeCode.hour;
+    tm.tm_min = timeCode.minute;
+    return timegm(&tm);
+}
+
+bool isLastDayOfMonth(const TimeCode& timeCode)
+{
+    time_t tomorrow = toUnixTime(timeCode) + 24 * 60 * 60;
+    struct tm tm;
+    gmtime_r(&tomorrow, &tm);
+    return tm.tm_mday == 1;
+}
+
+TimeCode nextMinute(const TimeCode& timeCode)
+{
+    TimeCode next = timeCode;
+
+    if (++next.minute < 60) return next;
+    next.minute = 0;
+
+    if (++next.hour < 24) return next;
+    next.hour = 0;
+
+    if (++next.dayOfYear <= daysInYear(next.year)) return next;
+    next.dayOfYear = 1;
+    next.year++;
+
+    return next;
+}
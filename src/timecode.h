@@ -0,0 +1,119 @@
+#ifndef _TIMECODE_H
+#define _TIMECODE_H
+
+#include <cstddef>
+#include <ctime>
+
+//=========================================================
+// WWV/WWVH time code frame layout. A frame is the 59
+// characters the decoder collects per minute: the reference
+// marker at index 0, then the data bits and position markers
+// for seconds 1-58 at the index of their second. Fields are
+// BCD, least significant bit first.
+//=========================================================
+const size_t TIMECODE_LENGTH = 59;
+
+// Stands in for a character that couldn't be decoded.
+const char ERASURE = '?';
+
+struct TimeCode
+{
+    int year;      // e.g. 2023
+    int dayOfYear; // 1-366
+    int hour;      // UTC
+    int minute;
+    bool leapSecondWarning; // a leap second is due at the end of the month
+};
+
+struct TimeCodeBit
+{
+    size_t index;
+    int weight;
+};
+
+const size_t LEAP_SECOND_WARNING_BIT = 3;
+
+constexpr TimeCodeBit YEAR_BITS[] = {
+    {4, 1}, {5, 2}, {6, 4}, {7, 8}, {51, 10}, {52, 20}, {53, 40}, {54, 80}};
+constexpr TimeCodeBit MINUTE_BITS[] = {
+    {10, 1}, {11, 2}, {12, 4}, {13, 8}, {15, 10}, {16, 20}, {17, 40}};
+constexpr TimeCodeBit HOUR_BITS[] = {
+    {20, 1}, {21, 2}, {22, 4}, {23, 8}, {25, 10}, {26, 20}};
+constexpr TimeCodeBit DAY_BITS[] = {
+    {30, 1}, {31, 2}, {32, 4}, {33, 8}, {35, 10}, {36, 20}, {37, 40}, {38, 80},
+    {40, 100}, {41, 200}};
+
+template <typename Frame, size_t NumBits>
+int decodeField(const Frame& frame, const TimeCodeBit (&bits)[NumBits])
+{
+    int value = 0;
+    for (auto& bit : bits)
+    {
+        value += frame[bit.index] == '1' ? bit.weight : 0;
+    }
+    return value;
+}
+
+template <typename Frame, size_t NumBits>
+void encodeField(Frame& frame, const TimeCodeBit (&bits)[NumBits], int value)
+{
+    for (auto& bit : bits)
+    {
+        int decade = bit.weight >= 100 ? 100 : bit.weight >= 10 ? 10 : 1;
+        int digit = (value / decade) % 10;
+        frame[bit.index] = (digit & (bit.weight / decade)) ? '1' : '0';
+    }
+}
+
+template <typename Frame>
+bool hasFieldErasures(const Frame& frame)
+{
+    auto erased = [&](auto& bits)
+    {
+        for (auto& bit : bits)
+        {
+            if (frame[bit.index] == ERASURE) return true;
+        }
+        return false;
+    };
+    
+    return erased(YEAR_BITS) || erased(DAY_BITS) || erased(HOUR_BITS) || erased(MINUTE_BITS);
+}
+
+template <typename Frame>
+TimeCode decodeTimeCode(const Frame& frame)
+{
+    TimeCode timeCode;
+    timeCode.year = 2000 + decodeField(frame, YEAR_BITS);
+    timeCode.dayOfYear = decodeField(frame, DAY_BITS);
+    timeCode.hour = decodeField(frame, HOUR_BITS);
+    timeCode.minute = decodeField(frame, MINUTE_BITS);
+    timeCode.leapSecondWarning = frame[LEAP_SECOND_WARNING_BIT] == '1';
+    return timeCode;
+}
+
+// Only overwrites the date and time fields; markers and the
+// DST/leap second/UT1 bits are left as they are.
+template <typename Frame>
+void encodeTimeCode(const TimeCode& timeCode, Frame& frame)
+{
+    encodeField(frame, YEAR_BITS, timeCode.year % 100);
+    encodeField(frame, DAY_BITS, timeCode.dayOfYear);
+    encodeField(frame, HOUR_BITS, timeCode.hour);
+    encodeField(frame, MINUTE_BITS, timeCode.minute);
+}
+
+bool isValid(const TimeCode& timeCode);
+
+int daysInYear(int year);
+
+// Unix time at the start of the given minute.
+time_t toUnixTime(const TimeCode& timeCode);
+
+bool isLastDayOfMonth(const TimeCode& timeCode);
+
+// The time code sent one minute after the given one (leap
+// seconds aside, these are entirely predictable).
+TimeCode nextMinute(const TimeCode& timeCode);
+
+#endif // _TIMECODE_H
@@ -1,455 +1,474 @@
 #include <cstdio>
+#include <cstdint>
 #include <iostream>
-#include <iomanip>
-#include <cmath>
-#include <deque>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
 
-#include <q/fx/envelope.hpp>
-#include <q/fx/dynamic.hpp>
-#include <q/fx/noise_gate.hpp>
-#include <q/fx/dc_block.hpp>
-#include <q/fx/moving_average.hpp>
+#include "fir.h"
+#include "input.h"
+#include "iq.h"
+#include "decoder.h"
+#include "metrics.h"
+#include "fusion.h"
+#include "pipeline.h"
+#include "refclock.h"
+#include "replay.h"
 
-#include "filt.h"
+// Where decoded time goes besides stdout.
+std::vector<std::unique_ptr<RefclockDriver>> refclocks;
 
-using namespace cycfi::q::literals;
+// Whether to read, detect and decode each input on separate
+// threads (see Pipeline).
+bool usePipeline = false;
+PipelineOptions pipelineOptions;
 
-const int SAMPLE_RATE = 8000;
-const int NUM_BLOCKS_PER_10_MS = SAMPLE_RATE * 0.01; // number of samples corresponding to a 0 or 1 for the carrier
+// Decode recordings into event logs instead (see Replay).
+bool replay = false;
+ReplayOptions replayOptions;
 
-cycfi::q::fast_ave_envelope_follower follower(2_ms, SAMPLE_RATE);
-cycfi::q::noise_gate ng(-32.5_dB);
-cycfi::q::dc_block dcBlocker(60_Hz, SAMPLE_RATE);
-cycfi::q::moving_average noiseAvg(200_ms, SAMPLE_RATE);
+// Raw I/Q instead of audio (see IqDemodulator).
+bool iqInput = false;
+IqFormat iqFormat = IQ_U8;
+int inputRate = 0;
 
-std::deque<char> carriersSeen;
-std::deque<double> windowCoeffs;
-int phasesRemaining = NUM_BLOCKS_PER_10_MS;
-bool lookingForPhase = true;
-
-enum 
-{
-    WAITING_FOR_BEGINNING, // Haven't seen the reference marker yet
-    WAITING_FOR_DATA,      // Data bits in between position markers 
-                           // (8 if we came from WAITING_FOR_BEGINNING, 
-                           // 9 otherwise).
-    WAITING_FOR_POSITION,  // Waiting for position marker
-} currentState = WAITING_FOR_BEGINNING;
-int dataBitsRemaining = 0;
-int positionsRemaining = 0;
+// Where to serve each decoder's metrics, if anywhere (see
+// MetricsServer).
+const char* metricsAddress = nullptr;
 
 //=========================================================
-// Predefined vectors indicating the possible "characters"
-// WWV/WWVH can send using the 100 Hz subcarrier.
-//
-// Note: each 1 and 0 below is 10ms, making each row 70-100ms 
-// long. 1 indicates the presence of the 100 Hz carrier, 0 
-// otherwise. Characters are defined beginning from when 
-// the carrier becomes high until when the next one should 
-// be present.
+// With more than one input, each decoder's output is
+// collected a line at a time and written out whole with the
+// input's name in front, so lines from decoders on other
+// threads don't end up in the middle of it.
 //=========================================================
-std::deque<char> ReferenceMarker = {
-    // 0.770s position identifier (P0)
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1,
-    
-    // Additional zeros so that the hole below starts at next
-    // second exactly (1.000 - 0.030 - 0.770 = 0.200s)
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    
-    // 1.030s "hole"
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0,
-};
+std::mutex outputLock;
 
-std::deque<char> ReferenceMarkerProcessed;
-
-std::deque<char> PositionMarker = {
-    // 0.770s position identifier (P1-P5)
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1,
+class PrefixedLineBuffer : public std::streambuf
+{
+public:
+    PrefixedLineBuffer(std::ostream& out, const std::string& name)
+        : out_(out)
+        , prefix_("[" + name + "] ")
+    {
+        // Nothing else to do.
+    }
     
-    // 0.230s gap before next character
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0,
-};
-
-std::deque<char> PositionMarkerProcessed;
-
-std::deque<char> OneBit = {
-    // 0.470s position identifier
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 
+    ~PrefixedLineBuffer()
+    {
+        if (!line_.empty())
+        {
+            line_ += '\n';
+            write_line();
+        }
+    }
     
-    // 0.530s gap before next character
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0,
-};
-
-std::deque<char> OneBitProcessed;
-
-std::deque<char> ZeroBit = {
-    // 0.170s position identifier
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1,
+protected:
+    int overflow(int c) override
+    {
+        if (c != traits_type::eof())
+        {
+            line_ += (char)c;
+            if (c == '\n')
+            {
+                write_line();
+            }
+        }
+        return c;
+    }
+    
+private:
+    std::ostream& out_;
+    std::string prefix_;
+    std::string line_;
     
-    // 0.830s gap before next character
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0,
+    void write_line()
+    {
+        std::lock_guard<std::mutex> lock(outputLock);
+        out_ << prefix_ << line_ << std::flush;
+        line_.clear();
+    }
 };
 
-std::deque<char> ZeroBitProcessed;
-
-bool fuzzyMatch(std::deque<char>& one, std::deque<char>& other)
+struct Input
 {
-    // Returns true if <= 12% of items in both don't match.
-    // Note: 12% is from experimentation based on OTA recordings of WWV.
-    int maxFailures = std::min(one.size(), other.size()) * 0.12;
-    int numFailures = 0;
-    
-    for (std::deque<char>::iterator i = one.begin(), j = other.begin();
-         i != one.end() && j != other.end();
-         i++, j++)
-     {
-         if (*i != *j)
-         {
-             numFailures++;
-             if (numFailures > maxFailures) return false;
-         }
-     }
-     
-     return true;
-}
+    std::string name;
+    std::unique_ptr<PrefixedLineBuffer> lineBuffer;
+    std::unique_ptr<std::ostream> out;
+    std::unique_ptr<WwvDecoder> decoder;
+    std::unique_ptr<DecoderMetrics> metrics;
+};
 
-void processIncomingSample(short sample)
+// Runs one input to the end; one of these per thread.
+void decodeInput(Input& input, size_t index, MinuteFusion& fusion)
 {
-    auto floatSample = (float)sample / SHRT_MAX;    
-    auto followOut = follower(floatSample);
-    
-    // Adjust moving average. Don't adjust thresholds yet.
-    // That will be done whenever we have enough samples to
-    // attempt a symbol decode.
-    noiseAvg(followOut);
-    
-    auto gateVal = ng(followOut);
-    
-    carriersSeen.push_back(gateVal ? 1 : 0);
+    // Per thread setting.
+    enableFlushToZero();
     
-    if (carriersSeen[0] == 0)
+    int fd = input.name == "-" ? STDIN_FILENO : open(input.name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
     {
-        // We should match on the first 1 we see to make the 
-        // rest of the decode logic work reliably.
-        carriersSeen.pop_front();
+        std::lock_guard<std::mutex> lock(outputLock);
+        std::cerr << input.name << ": " << strerror(errno) << std::endl;
     }
-}
-
-void parseTimeCode(std::deque<char>& timeCodeSeen)
-{
-    int year = 2000 + 
-        (timeCodeSeen[4] == '1' ? 1 : 0) +
-        (timeCodeSeen[5] == '1' ? 2 : 0) +
-        (timeCodeSeen[6] == '1' ? 4 : 0) +
-        (timeCodeSeen[7] == '1' ? 8 : 0);
-    
-    year += timeCodeSeen[51] == '1' ? 10 : 0;
-    year += timeCodeSeen[52] == '1' ? 20 : 0;
-    year += timeCodeSeen[53] == '1' ? 40 : 0;
-    year += timeCodeSeen[54] == '1' ? 80 : 0;
-    
-    int days = 
-        (timeCodeSeen[30] == '1' ? 1 : 0) +
-        (timeCodeSeen[31] == '1' ? 2 : 0) +
-        (timeCodeSeen[32] == '1' ? 4 : 0) +
-        (timeCodeSeen[33] == '1' ? 8 : 0) +
-            
-        (timeCodeSeen[35] == '1' ? 10 : 0) +
-        (timeCodeSeen[36] == '1' ? 20 : 0) +
-        (timeCodeSeen[37] == '1' ? 40 : 0) +
-        (timeCodeSeen[38] == '1' ? 80 : 0) +
-            
-        (timeCodeSeen[40] == '1' ? 100 : 0) +
-        (timeCodeSeen[41] == '1' ? 200 : 0);
-    
-    std::cout << "Date: " << "Day " << days << " of year " << year << std::endl;
-    
-    int hours = 
-        (timeCodeSeen[20] == '1' ? 1 : 0) +
-        (timeCodeSeen[21] == '1' ? 2 : 0) +
-        (timeCodeSeen[22] == '1' ? 4 : 0) +
-        (timeCodeSeen[23] == '1' ? 8 : 0) +
+    else
+    {
+        SampleReader reader(fd);
+        std::unique_ptr<IqReader> iqReader;
+        SampleSource* source = &reader;
+        if (iqInput)
+        {
+            iqReader = std::make_unique<IqReader>(reader, iqFormat, inputRate, INPUT_SAMPLE_RATE);
+            source = iqReader.get();
+        }
+        
+        if (usePipeline)
+        {
+            Pipeline pipeline(*input.decoder, pipelineOptions);
+            pipeline.run(*source);
             
-        (timeCodeSeen[25] == '1' ? 10 : 0) +
-        (timeCodeSeen[26] == '1' ? 20 : 0);
-    
-    int minutes = 
-        (timeCodeSeen[10] == '1' ? 1 : 0) +
-        (timeCodeSeen[11] == '1' ? 2 : 0) +
-        (timeCodeSeen[12] == '1' ? 4 : 0) +
-        (timeCodeSeen[13] == '1' ? 8 : 0) +
+            std::lock_guard<std::mutex> lock(outputLock);
+            std::cerr << input.name << ": pipeline dropped " << pipeline.blocks_dropped() 
+                      << " input blocks, DSP stalled " << pipeline.dsp_stalls() << " times" << std::endl;
+        }
+        else
+        {
+            const int16_t* samples = nullptr;
+            size_t numSamples = 0;
             
-        (timeCodeSeen[15] == '1' ? 10 : 0) +
-        (timeCodeSeen[16] == '1' ? 20 : 0) +
-        (timeCodeSeen[17] == '1' ? 40 : 0);
-    
-    std::cout << "Time (UTC): " << hours << ":" << std::setfill('0') << std::setw(2) << minutes << std::endl;
-}
-
-void processMarkers(std::deque<char>& orig, std::deque<char>& processed)
-{
-    // Converts 10ms blocks into 1ms blocks.
-    for (auto& item : orig)
-    {
-        for (int index = 0; index < NUM_BLOCKS_PER_10_MS; index++)
+            uint64_t samplesRead = 0;
+            while (source->next(samples, numSamples))
+            {
+                // A mapped file has no meaningful read times.
+                samplesRead += numSamples;
+                if (!source->is_mapped())
+                {
+                    timespec readTime;
+                    clock_gettime(CLOCK_REALTIME, &readTime);
+                    input.decoder->update_clock(samplesRead + source->latency(), readTime);
+                }
+                
+                input.decoder->process(samples, numSamples);
+            }
+        }
+        
+        if (fd != STDIN_FILENO)
         {
-            processed.push_back(item);
+            close(fd);
         }
     }
+    
+    fusion.input_finished(index);
 }
 
-int main()
+void usage(const char* progName)
 {
-    short sampleShort = 0;
-    std::deque<char> timeCodeSeen;
-    
-    cycfi::q::fast_rms_envelope_follower_db follower(1_s, SAMPLE_RATE);
-    cycfi::q::moving_average volAvg(1_s, SAMPLE_RATE);
+    std::cerr << "Usage: " << progName << " [options] [INPUT...]" << std::endl
+              << std::endl
+              << "Decodes WWV/WWVH time code from 16 bit mono audio at " << INPUT_SAMPLE_RATE << " Hz." << std::endl
+              << "Each INPUT (file, FIFO, /dev/fd/N, or - for stdin, the default) is decoded" << std::endl
+              << "on its own thread, e.g. one per WWV frequency, and the results for each" << std::endl
+              << "minute are combined, favoring the input with the best SNR." << std::endl
+              << std::endl
+              << "Options:" << std::endl
+              << "  -t, --bpf-taps N     bandpass filter length (default " << DEFAULT_BANDPASS_TAPS << ")" << std::endl
+              << "  -l, --bpf-low HZ     bandpass lower edge (default 75)" << std::endl
+              << "  -u, --bpf-high HZ    bandpass upper edge (default 150)" << std::endl
+              << "  -d, --detector MODE  carrier detector: envelope (default), quadrature," << std::endl
+              << "                       or ab to decode with envelope and report agreement" << std::endl
+              << "                       with quadrature on stderr" << std::endl
+              << "  -f, --flywheel SECS  keep time through up to SECS undecodable seconds" << std::endl
+              << "                       in a row once locked (default 60, 0 = off)" << std::endl
+              << "  -D, --delays W,H     path delay from WWV and WWVH in ms, taken out of" << std::endl
+              << "                       the timestamps according to which station's" << std::endl
+              << "                       ticks are heard most (default 0,0)" << std::endl
+              << "  -s, --shm UNIT       send time to ntpd/chrony SHM refclock unit UNIT" << std::endl
+              << "  -c, --chrony-sock PATH" << std::endl
+              << "                       send time to a chrony SOCK refclock at PATH" << std::endl
+              << "  -i, --iq FORMAT      input is raw interleaved I/Q, u8 (rtl_sdr) or s16," << std::endl
+              << "                       tuned to the carrier; it's AM demodulated and" << std::endl
+              << "                       decimated to " << INPUT_SAMPLE_RATE << " Hz" << std::endl
+              << "  -r, --rate HZ        input sample rate; a multiple of " << INPUT_SAMPLE_RATE << " for I/Q" << std::endl
+              << "                       (default " << DEFAULT_IQ_RATE << "), otherwise " << INPUT_SAMPLE_RATE << std::endl
+              << "  -P, --pipeline       read, detect and decode on separate threads so that" << std::endl
+              << "                       slow output never holds up reading the input" << std::endl
+              << "  -p, --pin R,D,O      pin the pipeline's reader, DSP and decode threads" << std::endl
+              << "                       to these CPUs (-1 = don't pin); implies -P" << std::endl
+              << "  -R, --replay         decode recordings as fast as possible and print a" << std::endl
+              << "                       log of locks, symbols, time codes and losses by" << std::endl
+              << "                       sample instead (files only)" << std::endl
+              << "  -j, --jobs N         replay on N threads (default: one per core)" << std::endl
+              << "  -S, --segment MIN    also split recordings into segments of about MIN" << std::endl
+              << "                       minutes (at least " << Replay::OVERLAP_MINUTES << ") to replay in parallel; results" << std::endl
+              << "                       may differ slightly where the signal is marginal" << std::endl
+              << "  -M, --metrics ADDRESS" << std::endl
+              << "                       serve Prometheus metrics over HTTP on [HOST:]PORT" << std::endl
+              << "                       (HOST defaults to 127.0.0.1) or a Unix socket path" << std::endl
+              << "  -h, --help           show this help" << std::endl;
+}
 
-    processMarkers(ReferenceMarker, ReferenceMarkerProcessed);
-    processMarkers(PositionMarker, PositionMarkerProcessed);
-    processMarkers(OneBit, OneBitProcessed);
-    processMarkers(ZeroBit, ZeroBitProcessed);
+int main(int argc, char** argv)
+{
+    DecoderOptions options;
     
-    Filter filt(BPF, 255, SAMPLE_RATE, 75, 150);
-    if (filt.get_error_flag() != 0)
-    {
-        std::cout << "Filter error: " << filt.get_error_flag() << std::endl;
-    }
-
-    //FILE* fp = fopen("tmp.raw", "wb");
-    //assert(fp != nullptr);
+    const struct option longOptions[] = {
+        {"bpf-taps", required_argument, nullptr, 't'},
+        {"bpf-low", required_argument, nullptr, 'l'},
+        {"bpf-high", required_argument, nullptr, 'u'},
+        {"detector", required_argument, nullptr, 'd'},
+        {"flywheel", required_argument, nullptr, 'f'},
+        {"delays", required_argument, nullptr, 'D'},
+        {"shm", required_argument, nullptr, 's'},
+        {"chrony-sock", required_argument, nullptr, 'c'},
+        {"iq", required_argument, nullptr, 'i'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"pipeline", no_argument, nullptr, 'P'},
+        {"pin", required_argument, nullptr, 'p'},
+        {"replay", no_argument, nullptr, 'R'},
+        {"jobs", required_argument, nullptr, 'j'},
+        {"segment", required_argument, nullptr, 'S'},
+        {"metrics", required_argument, nullptr, 'M'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
     
-    while (fread((void*)&sampleShort, sizeof(short), 1, stdin) > 0)
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:l:u:d:f:D:s:c:i:r:Pp:Rj:S:M:h", longOptions, nullptr)) != -1)
     {
-        // Block DC and amplify signal so that the decoder can pick it up.
-        float blockedAudio = dcBlocker((double)sampleShort / SHRT_MAX);
-        
-        sampleShort = (short)filt.do_sample(blockedAudio * SHRT_MAX);
-        
-        auto followedEnv = follower((double)sampleShort / SHRT_MAX);
-        auto dbRequiredtoAdd = -6_dB + -followedEnv;
-        auto multiplier = cycfi::q::lin_double(dbRequiredtoAdd);
-
-        sampleShort *= multiplier;
-        
-        //fwrite(&sampleShort, sizeof(short), 1, fp);
-        
-        processIncomingSample(sampleShort);
-        
-        bool adjustNoiseGate = false;
-        
-        switch (currentState)
+        switch (opt)
         {
-            case WAITING_FOR_BEGINNING:
-                if (carriersSeen.size() == ReferenceMarkerProcessed.size())
+            case 't':
+                options.bandpassTaps = atoi(optarg);
+                break;
+            case 'l':
+                options.bandpassLow = atof(optarg);
+                break;
+            case 'u':
+                options.bandpassHigh = atof(optarg);
+                break;
+            case 'd':
+                if (strcmp(optarg, "envelope") == 0) options.detectorMode = ENVELOPE_DETECTOR;
+                else if (strcmp(optarg, "quadrature") == 0) options.detectorMode = QUADRATURE_DETECTOR;
+                else if (strcmp(optarg, "ab") == 0) options.detectorMode = AB_COMPARE_DETECTORS;
+                else
                 {
-                    adjustNoiseGate = true;
-                    
-                    int numCarriersToPop = 0;
-                    if (fuzzyMatch(carriersSeen, ReferenceMarkerProcessed))
-                    {
-                        // Seen reference marker, now listen for first data bits
-                        dataBitsRemaining = 8;
-                        positionsRemaining = 5; // Expecting five more position bits
-                        currentState = WAITING_FOR_DATA;
-                    
-                        std::cout << std::endl;
-                        timeCodeSeen.push_back('R');
-                        std::cout << "R";
-                        
-                        // Since we're sync'd up with the radio now, we can shortcut the
-                        // rest of the matching.
-                        numCarriersToPop = carriersSeen.size();
-                        lookingForPhase = false;
-                    }
-                    else if (lookingForPhase && (
-                        fuzzyMatch(carriersSeen, OneBitProcessed) || 
-                        fuzzyMatch(carriersSeen, ZeroBitProcessed) ||
-                        fuzzyMatch(carriersSeen, ReferenceMarkerProcessed)))
-                    {
-                        // Another way we can shortcut the phase search is finding 1, 0 or P.
-                        // However, we still need to find R to start being able to read the time.
-                        std::cout << "Locked onto WWV signal" << std::endl;
-                        numCarriersToPop = OneBitProcessed.size();
-                        lookingForPhase = false;
-                    }
-                    else
-                    {
-                        // The channel was too noisy to receive the reference marker
-                        // (or we started listening in the middle of a time code).
-                        // Only pop the beginning of the list in case of the latter.
-                        carriersSeen.pop_front();
-                    }
-                    
-                    if (!lookingForPhase)
-                    {
-                        for (int i = 0; i < numCarriersToPop; i++)
-                        {
-                            carriersSeen.pop_front();
-                        }
-                    }
+                    usage(argv[0]);
+                    return 1;
                 }
                 break;
-            case WAITING_FOR_DATA:
-                if (carriersSeen.size() == OneBitProcessed.size()) // ZeroBit is the same size, or should be anyway
+            case 'f':
+                options.maxErasedSeconds = atoi(optarg);
+                break;
+            case 'D':
+                if (sscanf(optarg, "%lf,%lf", &options.wwvDelay, &options.wwvhDelay) != 2)
                 {
-                    adjustNoiseGate = true;
-                    
-                    bool found = false;
-                    if (fuzzyMatch(carriersSeen, OneBitProcessed))
-                    {
-                        timeCodeSeen.push_back('1');
-                        std::cout << "1";
-                        found = true;
-                    }
-                    else if (fuzzyMatch(carriersSeen, ZeroBitProcessed))
-                    {
-                        timeCodeSeen.push_back('0');
-                        std::cout << "0";
-                        found = true;
-                    }
-                    
-                    if (found)
-                    {
-                        dataBitsRemaining--;
-                        if (dataBitsRemaining == 0)
-                        {
-                            if (positionsRemaining == 0)
-                            {
-                                // We should have a full timecode now, print it out for now
-                                // TBD: do other things with it (e.g. generate Unix timestamp, inject into chrony)
-                                std::cout << std::endl;
-                                parseTimeCode(timeCodeSeen);
-                                timeCodeSeen.clear();
-                                
-                                currentState = WAITING_FOR_BEGINNING;
-                            }
-                            else
-                            {
-                                // We need to see another position marker now
-                                currentState = WAITING_FOR_POSITION;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        // We lost the WWV signal, so wait for another reference marker
-                        currentState = WAITING_FOR_BEGINNING;
-                        std::cout << std::endl << "lost sync during data wait" << std::endl;
-                        lookingForPhase = true;
-                        /*
-                        std::cout << "Expected (0): ";
-                        for (auto& x : ZeroBitProcessed)
-                        {
-                            std::cout << (x ? "1" : "0");
-                        }
-                        std::cout << std::endl;
-                        std::cout << "Expected (1): ";
-                        for (auto& x : OneBitProcessed)
-                        {
-                            std::cout << (x ? "1" : "0");
-                        }
-                        std::cout << std::endl;
-                        std::cout << "Actual:       ";
-                        for (auto& x : carriersSeen)
-                        {
-                            std::cout << (x ? "1" : "0");
-                        }
-                        std::cout << std::endl;
-                        std::cout << "file idnex " << ftell(stdin) << std::endl;
-                        */
-                        timeCodeSeen.clear();
-                    }
-                    
-                    carriersSeen.clear();
+                    usage(argv[0]);
+                    return 1;
                 }
+                options.wwvDelay /= 1000;
+                options.wwvhDelay /= 1000;
                 break;
-            case WAITING_FOR_POSITION:
-                if (carriersSeen.size() == PositionMarkerProcessed.size())
+            case 's':
+            {
+                auto shm = std::make_unique<ShmRefclock>(atoi(optarg));
+                if (!shm->is_open())
                 {
-                    adjustNoiseGate = true;
-                    
-                    if (fuzzyMatch(carriersSeen, PositionMarkerProcessed))
-                    {
-                        dataBitsRemaining = 9;
-                        positionsRemaining--;
-                        currentState = WAITING_FOR_DATA;
-                
-                        timeCodeSeen.push_back('P');
-                        std::cout << "P";
-                    }
-                    else
-                    {
-                        // We lost the WWV signal, so wait for another reference marker
-                        std::cout << std::endl << "lost sync during position wait" << std::endl;
-                        currentState = WAITING_FOR_BEGINNING;
-                        timeCodeSeen.clear();
-                        
-                        lookingForPhase = false;
-                    }
-                    
-                    carriersSeen.clear();
+                    return 1;
                 }
+                refclocks.push_back(std::move(shm));
+                break;
+            }
+            case 'c':
+                refclocks.push_back(std::make_unique<SockRefclock>(optarg));
+                break;
+            case 'i':
+                if (strcmp(optarg, "u8") == 0) iqFormat = IQ_U8;
+                else if (strcmp(optarg, "s16") == 0) iqFormat = IQ_S16;
+                else
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                iqInput = true;
+                break;
+            case 'r':
+                inputRate = atoi(optarg);
                 break;
-        };
+            case 'P':
+                usePipeline = true;
+                break;
+            case 'p':
+                if (sscanf(optarg, "%d,%d,%d", &pipelineOptions.readerCpu, 
+                           &pipelineOptions.dspCpu, &pipelineOptions.decodeCpu) != 3)
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                usePipeline = true;
+                break;
+            case 'R':
+                replay = true;
+                break;
+            case 'j':
+                replayOptions.jobs = atoi(optarg);
+                break;
+            case 'S':
+                replayOptions.segmentMinutes = atoi(optarg);
+                break;
+            case 'M':
+                metricsAddress = optarg;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    
+    if (iqInput)
+    {
+        if (inputRate == 0) inputRate = DEFAULT_IQ_RATE;
+        if (!IqDemodulator(iqFormat, inputRate, INPUT_SAMPLE_RATE).valid())
+        {
+            std::cerr << "I/Q sample rate must be a multiple of " << INPUT_SAMPLE_RATE << " Hz" << std::endl;
+            return 1;
+        }
+    }
+    else if (inputRate != 0 && inputRate != INPUT_SAMPLE_RATE)
+    {
+        std::cerr << "Audio input must be " << INPUT_SAMPLE_RATE << " Hz (use --iq for I/Q input)" << std::endl;
+        return 1;
+    }
+    
+    // A bad design would leave every decoder without its bandpass
+    // filter, so it's caught here rather than in each of them.
+    Filter bandpassDesign(BPF, options.bandpassTaps, SAMPLE_RATE, options.bandpassLow, options.bandpassHigh);
+    if (bandpassDesign.get_error_flag() != 0)
+    {
+        std::cerr << "Bandpass filter needs 0 < --bpf-low < --bpf-high < " << SAMPLE_RATE / 2 
+                  << " Hz and 1 to " << MAX_NUM_FILTER_TAPS << " taps" << std::endl;
+        return 1;
+    }
+    if (options.bandpassTaps > MAX_BANDPASS_TAPS)
+    {
+        std::cerr << "The fixed point build's bandpass filter is limited to " << MAX_BANDPASS_TAPS << " taps" << std::endl;
+        return 1;
+    }
+    if (options.bandpassLow >= 100 || options.bandpassHigh <= 100)
+    {
+        std::cerr << "Bandpass filter has to pass the 100 Hz subcarrier (--bpf-low < 100 < --bpf-high)" << std::endl;
+        return 1;
+    }
+    
+    if (replay)
+    {
+        if (iqInput || optind == argc)
+        {
+            std::cerr << "--replay takes one or more recordings (16 bit mono) as arguments" << std::endl;
+            return 1;
+        }
+        if (metricsAddress != nullptr)
+        {
+            std::cerr << "--metrics is for live decoding, not --replay" << std::endl;
+            return 1;
+        }
         
-        if (adjustNoiseGate)
+        Replay replayer(options, replayOptions);
+        return replayer.run(std::vector<std::string>(argv + optind, argv + argc), std::cout) ? 0 : 1;
+    }
+    
+    std::vector<Input> inputs(std::max(argc - optind, 1));
+    std::vector<std::string> names;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        inputs[i].name = optind + (int)i < argc ? argv[optind + i] : "-";
+        names.push_back(inputs[i].name);
+    }
+    
+    // A single input writes straight to stdout, as it always has.
+    bool multipleInputs = inputs.size() > 1;
+    PrefixedLineBuffer fusedLineBuffer(std::cout, "fused");
+    std::ostream fusedOut(&fusedLineBuffer);
+    MinuteFusion fusion(names, refclocks, multipleInputs ? &fusedOut : nullptr);
+    
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        Input& input = inputs[i];
+        if (multipleInputs)
         {
-            // Adjust noise gate threshold for next go-around.
-            auto noiseLevelDB = cycfi::q::lin_to_db(noiseAvg());
-            ng.release_threshold(noiseLevelDB);
+            input.lineBuffer = std::make_unique<PrefixedLineBuffer>(std::cout, input.name);
+            input.out = std::make_unique<std::ostream>(input.lineBuffer.get());
         }
         
-        fflush(stdout);
+        std::ostream& out = multipleInputs ? *input.out : std::cout;
+        input.decoder = std::make_unique<WwvDecoder>(options, out, 
+            [&fusion, i](const DecodedMinute& minute) { fusion.add(i, minute); });
+        
+        if (metricsAddress != nullptr)
+        {
+            input.metrics = std::make_unique<DecoderMetrics>();
+            input.decoder->set_metrics(input.metrics.get());
+        }
     }
     
-    //fclose(fp);
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (metricsAddress != nullptr)
+    {
+        MetricsServer::Sources sources;
+        for (auto& input : inputs)
+        {
+            sources.emplace_back(input.name, input.metrics.get());
+        }
+        
+        metricsServer = std::make_unique<MetricsServer>(metricsAddress, sources);
+        if (!metricsServer->is_open())
+        {
+            return 1;
+        }
+    }
+    
+    if (!multipleInputs)
+    {
+        decodeInput(inputs[0], 0, fusion);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            threads.emplace_back(decodeInput, std::ref(inputs[i]), i, std::ref(fusion));
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+    
+    for (auto& input : inputs)
+    {
+        if (input.decoder->detector_mode() == AB_COMPARE_DETECTORS)
+        {
+            if (multipleInputs) std::cerr << input.name << ":" << std::endl;
+            input.decoder->detector_comparison().report(std::cerr);
+        }
+    }
+    
+    for (auto& refclock : refclocks)
+    {
+        std::cerr << refclock->name() << ": " << refclock->samples_sent() << " samples sent, "
+                  << refclock->samples_dropped() << " dropped" << std::endl;
+    }
     
     return 0;
 }
@@ -0,0 +1,208 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "decoder.h"
+#include "synth.h"
+
+void usage(const char* progName)
+{
+    std::cerr << "Usage: " << progName << " [options] > OUTPUT" << std::endl
+              << std::endl
+              << "Writes a synthetic WWV/WWVH signal to stdout as 16 bit mono audio at " << INPUT_SAMPLE_RATE << " Hz," << std::endl
+              << "the same as wwv takes as input." << std::endl
+              << std::endl
+              << "Options:" << std::endl
+              << "  -d, --duration SECS  how much to generate (default 3600)" << std::endl
+              << "  -t, --time TIME      time code of the first minute as YYYY.DDD HH:MM" << std::endl
+              << "                       (default 2023.207 02:00)" << std::endl
+              << "  -o, --offset SECS    start this far into the first minute" << std::endl
+              << "  -s, --station NAME   wwv (default), wwvh or both" << std::endl
+              << "  -l, --levels W,H     amplitude of WWV and WWVH relative to full strength" << std::endl
+              << "                       (default 1,1 for the stations sent)" << std::endl
+              << "  -p, --delays W,H     propagation delay of WWV and WWVH in ms" << std::endl
+              << "  -x, --no-tones       leave out the 440/500/600 Hz tones" << std::endl
+              << "  -n, --snr DB         add white noise: 100 Hz subcarrier over noise power" << std::endl
+              << "                       across the whole band (default none)" << std::endl
+              << "  -f, --fading HZ      Rayleigh fading with this Doppler spread" << std::endl
+              << "  -q, --qrn RATE[,LEVEL]" << std::endl
+              << "                       static crashes per second, up to LEVEL times 100%" << std::endl
+              << "                       modulation (default 2)" << std::endl
+              << "  -c, --clock PPM      sound card clock runs this many ppm fast" << std::endl
+              << "  -e, --seed N         seed for the noise, fading and static (default 1)" << std::endl
+              << "  -m, --markers        list on stderr the output sample at which each" << std::endl
+              << "                       minute begins, per station" << std::endl
+              << "  -h, --help           show this help" << std::endl;
+}
+
+bool parseTimeCode(const char* text, TimeCode& timeCode)
+{
+    timeCode.leapSecondWarning = false;
+    return sscanf(text, "%d.%d %d:%d", &timeCode.year, &timeCode.dayOfYear, &timeCode.hour, &timeCode.minute) == 4 &&
+           isValid(timeCode);
+}
+
+int main(int argc, char** argv)
+{
+    SynthOptions options;
+    double duration = 3600;
+    bool markers = false;
+    bool levelsGiven = false;
+    const char* station = "wwv";
+
+    const struct option longOptions[] = {
+        {"duration", required_argument, nullptr, 'd'},
+        {"time", required_argument, nullptr, 't'},
+        {"offset", required_argument, nullptr, 'o'},
+        {"station", required_argument, nullptr, 's'},
+        {"levels", required_argument, nullptr, 'l'},
+        {"delays", required_argument, nullptr, 'p'},
+        {"no-tones", no_argument, nullptr, 'x'},
+        {"snr", required_argument, nullptr, 'n'},
+        {"fading", required_argument, nullptr, 'f'},
+        {"qrn", required_argument, nullptr, 'q'},
+        {"clock", required_argument, nullptr, 'c'},
+        {"seed", required_argument, nullptr, 'e'},
+        {"markers", no_argument, nullptr, 'm'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:t:o:s:l:p:xn:f:q:c:e:mh", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                duration = atof(optarg);
+                break;
+            case 't':
+                if (!parseTimeCode(optarg, options.start))
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'o':
+                options.startSecond = atof(optarg);
+                break;
+            case 's':
+                station = optarg;
+                break;
+            case 'l':
+                if (sscanf(optarg, "%lf,%lf", &options.wwvLevel, &options.wwvhLevel) != 2)
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                levelsGiven = true;
+                break;
+            case 'p':
+                if (sscanf(optarg, "%lf,%lf", &options.wwvDelay, &options.wwvhDelay) != 2)
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                options.wwvDelay /= 1000;
+                options.wwvhDelay /= 1000;
+                break;
+            case 'x':
+                options.tones = false;
+                break;
+            case 'n':
+                options.snr = atof(optarg);
+                break;
+            case 'f':
+                options.fadingRate = atof(optarg);
+                break;
+            case 'q':
+                if (sscanf(optarg, "%lf,%lf", &options.qrnRate, &options.qrnLevel) < 1)
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'c':
+                options.clockPpm = atof(optarg);
+                break;
+            case 'e':
+                options.seed = atoi(optarg);
+                break;
+            case 'm':
+                markers = true;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    bool wwv = strcmp(station, "wwv") == 0 || strcmp(station, "both") == 0;
+    bool wwvh = strcmp(station, "wwvh") == 0 || strcmp(station, "both") == 0;
+    if (optind != argc || (!wwv && !wwvh) || options.startSecond < 0 || options.startSecond >= 60)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!levelsGiven)
+    {
+        options.wwvLevel = 1;
+        options.wwvhLevel = 1;
+    }
+    if (!wwv) options.wwvLevel = 0;
+    if (!wwvh) options.wwvhLevel = 0;
+
+    if (isatty(STDOUT_FILENO))
+    {
+        std::cerr << "Not writing audio to a terminal; redirect or pipe stdout" << std::endl;
+        return 1;
+    }
+
+    WwvSynthesizer synthesizer(options);
+    uint64_t numSamples = (uint64_t)(duration * INPUT_SAMPLE_RATE * (1 + options.clockPpm / 1e6));
+
+    if (markers)
+    {
+        int numMinutes = (int)((options.startSecond + duration) / 60) + 1;
+        std::cerr << std::fixed << std::setprecision(2);
+        for (int minute = 0; minute <= numMinutes; minute++)
+        {
+            TimeCode timeCode = synthesizer.minute_time_code(minute);
+            for (Station which : {WWV, WWVH})
+            {
+                double level = which == WWV ? options.wwvLevel : options.wwvhLevel;
+                double sample = synthesizer.minute_sample(which, minute);
+                if (level <= 0 || sample < 0 || sample >= numSamples) continue;
+
+                std::cerr << sample << " " << timeCode.year << "." << std::setfill('0') << std::setw(3) << timeCode.dayOfYear
+                          << " " << std::setw(2) << timeCode.hour << ":" << std::setw(2) << timeCode.minute
+                          << std::setfill(' ') << (which == WWV ? " wwv" : " wwvh") << std::endl;
+            }
+        }
+    }
+
+    std::vector<int16_t> buffer(INPUT_SAMPLE_RATE);
+    while (synthesizer.position() < numSamples)
+    {
+        size_t count = std::min<uint64_t>(buffer.size(), numSamples - synthesizer.position());
+        synthesizer.generate(buffer.data(), count);
+        if (fwrite(buffer.data(), sizeof(int16_t), count, stdout) != count)
+        {
+            // Whoever reads the output may well stop early.
+            if (errno == EPIPE) return 0;
+            perror("wwv_synth");
+            return 1;
+        }
+    }
+
+    return fflush(stdout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "check.h"
+#include "decoder.h"
+#include "metrics.h"
+#include "synth.h"
+
+// Once it's running, the decoder must not allocate: all of its
+// history lives in fixed rings sized at compile time. Counts calls
+// to the global operator new while a warmed up decoder decodes
+// several more minutes.
+
+namespace
+{
+
+bool counting = false;
+long allocations = 0;
+
+// Long enough to lock and decode a couple of minutes first.
+const int WARMUP_SECONDS = 3 * 60;
+const int COUNTED_SECONDS = 4 * 60;
+
+void checkNoAllocations(const char* name, DetectorMode mode, bool withMetrics)
+{
+    std::vector<int16_t> audio = synthesize(SynthOptions(), WARMUP_SECONDS + COUNTED_SECONDS);
+    
+    DecoderOptions options;
+    options.detectorMode = mode;
+    std::ostream discard(nullptr);
+    int numMinutes = 0;
+    WwvDecoder decoder(options, discard, [&numMinutes](const DecodedMinute&) { numMinutes++; });
+    DecoderMetrics metrics;
+    if (withMetrics) decoder.set_metrics(&metrics);
+    
+    // In reads of the size wwv uses.
+    const size_t READ_SIZE = 4096;
+    size_t warmup = WARMUP_SECONDS * INPUT_SAMPLE_RATE;
+    for (size_t pos = 0; pos < warmup; pos += READ_SIZE)
+    {
+        decoder.process(&audio[pos], std::min(READ_SIZE, warmup - pos));
+    }
+    int warmupMinutes = numMinutes;
+    
+    allocations = 0;
+    counting = true;
+    for (size_t pos = warmup; pos < audio.size(); pos += READ_SIZE)
+    {
+        decoder.process(&audio[pos], std::min(READ_SIZE, audio.size() - pos));
+    }
+    counting = false;
+    
+    std::cout << name << ": " << allocations << " allocations while decoding " 
+              << (numMinutes - warmupMinutes) << " minutes" << std::endl;
+    CHECK(warmupMinutes > 0);
+    CHECK(numMinutes - warmupMinutes >= COUNTED_SECONDS / 60 - 1);
+    CHECK(allocations == 0);
+}
+
+}
+
+void* operator new(size_t size)
+{
+    if (counting) allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    free(p);
+}
+
+int main()
+{
+    // Make sure the counting operator new is the one in use.
+    static std::vector<int>* escaped;
+    allocations = 0;
+    counting = true;
+    escaped = new std::vector<int>();
+    counting = false;
+    CHECK(allocations == 1);
+    delete escaped;
+    
+    checkNoAllocations("envelope", ENVELOPE_DETECTOR, false);
+    checkNoAllocations("quadrature", QUADRATURE_DETECTOR, false);
+    checkNoAllocations("ab", AB_COMPARE_DETECTORS, false);
+    checkNoAllocations("envelope with metrics", ENVELOPE_DETECTOR, true);
+    
+    return checkResult();
+}
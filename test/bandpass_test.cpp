@@ -0,0 +1,70 @@
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "decoder.h"
+#include "synth.h"
+
+// Bandpass filters longer than the default spread the carrier's
+// edges over hundreds of milliseconds, and ring for as long. They
+// still have to decode every minute of a good signal.
+
+namespace
+{
+
+const int SIGNAL_SECONDS = 10 * 60;
+
+// Decodes the synthetic signal with a bandpass filter of the given
+// length, and checks it comes out as the minutes that were sent. The
+// first can be missed while the decoder finds the phase, and the
+// last is cut off.
+void checkDecodes(const char* name, const SynthOptions& synthOptions, int taps)
+{
+    std::vector<int16_t> audio = synthesize(synthOptions, SIGNAL_SECONDS);
+
+    DecoderOptions options;
+    options.bandpassTaps = taps;
+    std::ostream discard(nullptr);
+    std::vector<TimeCode> minutes;
+    WwvDecoder decoder(options, discard, [&minutes](const DecodedMinute& minute) { minutes.push_back(minute.timeCode); });
+    decoder.process(audio.data(), audio.size());
+
+    size_t sent = 0;
+    for (const TimeCode& timeCode : minutes)
+    {
+        if (timeCode.year == 2023 && timeCode.dayOfYear == 207 && timeCode.hour == 2 &&
+            timeCode.minute >= 0 && timeCode.minute < SIGNAL_SECONDS / 60)
+        {
+            sent++;
+        }
+    }
+
+    std::cout << name << ", " << taps << " taps: " << sent << " of " << minutes.size()
+              << " minutes decoded were sent" << std::endl;
+    CHECK(sent == minutes.size());
+    CHECK(sent >= SIGNAL_SECONDS / 60 - 2);
+}
+
+}
+
+int main()
+{
+    SynthOptions clean;
+    SynthOptions noisy;
+    noisy.snr = 25;
+
+    // The same lengths in time at any decimation, as far as the
+    // build goes (see MAX_BANDPASS_TAPS).
+    for (int taps : {1024 / DECIMATION, 2048 / DECIMATION, 8192 / DECIMATION})
+    {
+        if (taps > MAX_BANDPASS_TAPS)
+        {
+            std::cout << taps << " taps: longer than this build takes" << std::endl;
+            continue;
+        }
+        checkDecodes("clean", clean, taps);
+        checkDecodes("noisy", noisy, taps);
+    }
+
+    return checkResult();
+}
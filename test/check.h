@@ -0,0 +1,46 @@
+#ifndef _CHECK_H
+#define _CHECK_H
+
+#include <cmath>
+#include <iostream>
+
+//=========================================================
+// Just enough of a test harness. Each test is a program that
+// runs its checks from main() and returns checkResult(), so
+// ctest sees it fail if any of them did:
+//
+//   CHECK(filter.num_taps() == 255);
+//   CHECK_NEAR(fast, direct, 1e-5);
+//
+// A failed check prints where it was and carries on.
+//=========================================================
+inline int& checkFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline bool checkFailed(const char* file, int line, const char* what)
+{
+    std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+    checkFailures()++;
+    return false;
+}
+
+#define CHECK(cond) ((cond) || checkFailed(__FILE__, __LINE__, #cond))
+
+#define CHECK_NEAR(a, b, tolerance) \
+    (std::abs((double)(a) - (double)(b)) <= (tolerance) || \
+     checkFailed(__FILE__, __LINE__, #a " within " #tolerance " of " #b))
+
+inline int checkResult()
+{
+    if (checkFailures() > 0)
+    {
+        std::cerr << checkFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif // _CHECK_H
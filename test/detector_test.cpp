@@ -0,0 +1,76 @@
+#include <vector>
+
+#include "check.h"
+#include "decoder.h"
+#include "synth.h"
+
+// The quadrature detector has to see the same carrier the envelope
+// detector does: one rise and one fall for every second's pulse,
+// not a flurry of them where a tone it doesn't reject, such as the
+// 440 Hz one in minute 1, beats with the subcarrier. Its decoded
+// minutes have to keep up with the envelope detector's, too.
+
+namespace
+{
+
+const int SIGNAL_SECONDS = 10 * 60;
+
+// One pulse every second except the hole at second 0.
+const long PULSE_EDGES = 2 * (SIGNAL_SECONDS - SIGNAL_SECONDS / 60);
+
+// Minutes of the synthetic signal the decoder gets right.
+size_t decodeMinutes(const std::vector<int16_t>& audio, DetectorMode mode, DetectorComparison* comparison = nullptr)
+{
+    DecoderOptions options;
+    options.detectorMode = mode;
+    std::ostream discard(nullptr);
+    std::vector<TimeCode> minutes;
+    WwvDecoder decoder(options, discard, [&minutes](const DecodedMinute& minute) { minutes.push_back(minute.timeCode); });
+    decoder.process(audio.data(), audio.size());
+    if (comparison != nullptr) *comparison = decoder.detector_comparison();
+
+    size_t sent = 0;
+    for (const TimeCode& timeCode : minutes)
+    {
+        if (timeCode.year == 2023 && timeCode.dayOfYear == 207 && timeCode.hour == 2 &&
+            timeCode.minute >= 0 && timeCode.minute < SIGNAL_SECONDS / 60)
+        {
+            sent++;
+        }
+    }
+    return sent;
+}
+
+void checkAgrees(const char* name, const SynthOptions& synthOptions)
+{
+    std::vector<int16_t> audio = synthesize(synthOptions, SIGNAL_SECONDS);
+
+    DetectorComparison comparison;
+    size_t envelopeMinutes = decodeMinutes(audio, AB_COMPARE_DETECTORS, &comparison);
+    size_t quadratureMinutes = decodeMinutes(audio, QUADRATURE_DETECTOR);
+
+    std::cout << name << ": transitions " << comparison.envelopeEdges << " vs. " << comparison.quadratureEdges
+              << " (" << PULSE_EDGES << " sent), minutes " << envelopeMinutes << " vs. " << quadratureMinutes
+              << std::endl;
+    CHECK(comparison.quadratureEdges <= comparison.envelopeEdges);
+    CHECK(comparison.quadratureEdges <= PULSE_EDGES * 11 / 10);
+    CHECK(quadratureMinutes + 1 >= envelopeMinutes);
+}
+
+}
+
+int main()
+{
+    SynthOptions clean;
+    SynthOptions noisy;
+    noisy.snr = 20;
+    SynthOptions faded;
+    faded.fadingRate = 0.1;
+    faded.snr = 30;
+
+    checkAgrees("clean", clean);
+    checkAgrees("noisy", noisy);
+    checkAgrees("faded", faded);
+
+    return checkResult();
+}
@@ -0,0 +1,75 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "fir.h"
+
+// FirFilter has to give the same output as the Filter it takes its
+// taps from, whichever kernel it runs (up to float rounding).
+
+namespace
+{
+
+const int SAMPLE_RATE = 8000;
+
+// The 100 Hz subcarrier in noise, at about full scale.
+std::vector<float> testSignal(size_t count)
+{
+    std::mt19937 random(1);
+    std::normal_distribution<float> noise(0, 0.3f);
+    std::vector<float> signal(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        signal[i] = 0.5f * sin(2 * M_PI * 100 * i / SAMPLE_RATE) + noise(random);
+    }
+    return signal;
+}
+
+void checkAgainstFilter(int numTaps, const NamedDotKernel& kernel)
+{
+    std::vector<float> input = testSignal(2 * SAMPLE_RATE);
+    
+    Filter reference(BPF, numTaps, SAMPLE_RATE, 75, 150);
+    Filter design(BPF, numTaps, SAMPLE_RATE, 75, 150);
+    FirFilter filter(design);
+    filter.use_kernel(kernel);
+    
+    // Half through do_sample() and half through process().
+    size_t half = input.size() / 2;
+    std::vector<float> output(input.size());
+    for (size_t i = 0; i < half; i++)
+    {
+        output[i] = filter.do_sample(input[i]);
+    }
+    filter.process(&input[half], &output[half], input.size() - half);
+    
+    double maxError = 0;
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        maxError = std::max(maxError, fabs(output[i] - reference.do_sample(input[i])));
+    }
+    
+    std::cout << kernel.name << ", " << numTaps << " taps: max error " << maxError << std::endl;
+    CHECK(maxError < 1e-5);
+}
+
+}
+
+int main()
+{
+    for (const NamedDotKernel& kernel : supportedDotKernels())
+    {
+        // The default, and lengths that leave each kernel a tail.
+        for (int numTaps : {255, 7, 33, 1023})
+        {
+            checkAgainstFilter(numTaps, kernel);
+        }
+    }
+    
+    Filter design(BPF, 255, SAMPLE_RATE, 75, 150);
+    FirFilter filter(design);
+    CHECK(filter.kernel_name() == supportedDotKernels().back().name);
+    
+    return checkResult();
+}
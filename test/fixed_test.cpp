@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "check.h"
+#include "decoder.h"
+#include "synth.h"
+
+// The fixed point build has to decode what the float build does.
+// Replays the same synthetic signals through this build's wwv and
+// the one built with the other sample type (see CMakeLists.txt),
+// and compares the minutes and markers they print.
+
+namespace
+{
+
+const int SIGNAL_SECONDS = 10 * 60;
+
+struct ReplayedMinute
+{
+    std::string time;
+    double marker;
+};
+
+// The "time" lines of a --replay log, e.g.
+// 952271 time 2023.207 02:01 marker 480000.00 wwv
+std::vector<ReplayedMinute> replay(const char* wwv, const std::string& args, const char* path)
+{
+    std::vector<ReplayedMinute> minutes;
+    std::string command = std::string(wwv) + " --replay " + args + " " + path + " 2>/dev/null";
+    FILE* fp = popen(command.c_str(), "r");
+    if (!CHECK(fp != nullptr)) return minutes;
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != nullptr)
+    {
+        unsigned long long sample;
+        char date[16], time[8], station[8];
+        double marker;
+        if (sscanf(line, "%llu time %15s %7s marker %lf %7s", &sample, date, time, &marker, station) == 5)
+        {
+            minutes.push_back({std::string(date) + " " + time + " " + station, marker});
+        }
+    }
+    CHECK(pclose(fp) == 0);
+    return minutes;
+}
+
+// With args for both wwv, e.g. a bandpass filter length.
+void checkSameMinutes(const char* name, const SynthOptions& synthOptions, const char* wwv, const char* otherWwv,
+                      const std::string& args = "", size_t minMinutes = SIGNAL_SECONDS / 60 - 2)
+{
+    std::vector<int16_t> audio = synthesize(synthOptions, SIGNAL_SECONDS);
+
+    char path[] = "fixed_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (!CHECK(fd >= 0)) return;
+    CHECK(write(fd, audio.data(), audio.size() * sizeof(int16_t)) == (ssize_t)(audio.size() * sizeof(int16_t)));
+    close(fd);
+
+    std::vector<ReplayedMinute> minutes = replay(wwv, args, path);
+    std::vector<ReplayedMinute> otherMinutes = replay(otherWwv, args, path);
+    unlink(path);
+
+    std::cout << name << ": " << minutes.size() << " and " << otherMinutes.size()
+              << " minutes decoded" << std::endl;
+    CHECK(minutes.size() >= minMinutes);
+    if (!CHECK(minutes.size() == otherMinutes.size())) return;
+    for (size_t i = 0; i < minutes.size(); i++)
+    {
+        CHECK(minutes[i].time == otherMinutes[i].time);
+        CHECK_NEAR(minutes[i].marker, otherMinutes[i].marker, 1.0);
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: " << argv[0] << " WWV OTHER_WWV" << std::endl;
+        return 2;
+    }
+
+    SynthOptions clean;
+    checkSameMinutes("clean", clean, argv[1], argv[2]);
+
+    // Where the fixed point build used to lose the first minutes.
+    SynthOptions noisy;
+    noisy.tones = false;
+    noisy.snr = 45;
+    noisy.seed = 3;
+    checkSameMinutes("45 dB, no tones", noisy, argv[1], argv[2]);
+
+    // The longest filter the fixed point build takes, which also
+    // holds the noise gate between its bounds, and is what gets a
+    // weak signal through the noise.
+    std::string longFilter = "--bpf-taps " + std::to_string(FAST_CONVOLUTION_MIN_TAPS - 1);
+    checkSameMinutes("long filter", clean, argv[1], argv[2], longFilter);
+
+    SynthOptions weak;
+    weak.snr = 25;
+    checkSameMinutes("long filter, 25 dB", weak, argv[1], argv[2], longFilter);
+
+    // Where the AGC and noise gate follow the level around, and
+    // rounding in either build could tip a marginal pulse.
+    SynthOptions faded;
+    faded.fadingRate = 0.1;
+    checkSameMinutes("faded", faded, argv[1], argv[2], "", SIGNAL_SECONDS / 60 - 4);
+
+    return checkResult();
+}
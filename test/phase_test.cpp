@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <vector>
+
+#include "check.h"
+#include "decoder.h"
+#include "synth.h"
+
+// A position marker followed by a 0 bit is within the mismatch
+// allowed for the reference marker R (P0 and the hole of second
+// 0). If the 0's pulse is lost when the decoder starts, P1 and
+// second 10 look exactly like R and the decoder locks a second
+// late, and nothing tells the first minute it decodes from a real
+// one. A minute later the same second comes round with its pulse,
+// and taking it for R again would keep the decoder out of phase
+// for good, decoding minutes that were never sent.
+
+namespace
+{
+
+const int SIGNAL_SECONDS = 7 * 60;
+
+// Starts two seconds into 02:00, so that P1 (second 9) is the first
+// marker the decoder can mistake for R.
+const double START_SECOND = 2;
+
+void checkNoMinutesOutOfPhase(const char* name, DetectorMode mode)
+{
+    SynthOptions synthOptions;
+    synthOptions.startSecond = START_SECOND;
+    std::vector<int16_t> audio = synthesize(synthOptions, SIGNAL_SECONDS);
+
+    // Lose the pulse of second 10 in the first minute.
+    auto pulse = audio.begin() + (size_t)((10 - START_SECOND) * INPUT_SAMPLE_RATE);
+    std::fill(pulse, pulse + INPUT_SAMPLE_RATE / 2, 0);
+
+    DecoderOptions options;
+    options.detectorMode = mode;
+    std::ostream discard(nullptr);
+    std::vector<TimeCode> minutes;
+    WwvDecoder decoder(options, discard, [&minutes](const DecodedMinute& minute) { minutes.push_back(minute.timeCode); });
+    decoder.process(audio.data(), audio.size());
+
+    size_t sent = 0;
+    for (size_t i = 1; i < minutes.size(); i++)
+    {
+        const TimeCode& timeCode = minutes[i];
+        if (timeCode.year == 2023 && timeCode.dayOfYear == 207 && timeCode.hour == 2 &&
+            timeCode.minute >= 0 && timeCode.minute < SIGNAL_SECONDS / 60)
+        {
+            sent++;
+        }
+    }
+
+    size_t afterFirst = minutes.empty() ? 0 : minutes.size() - 1;
+    std::cout << name << ": " << sent << " of the " << afterFirst
+              << " minutes decoded after the first were sent" << std::endl;
+    CHECK(sent == afterFirst);
+    CHECK(sent >= SIGNAL_SECONDS / 60 - 3);
+}
+
+}
+
+int main()
+{
+    checkNoMinutesOutOfPhase("envelope", ENVELOPE_DETECTOR);
+    checkNoMinutesOutOfPhase("quadrature", QUADRATURE_DETECTOR);
+
+    return checkResult();
+}
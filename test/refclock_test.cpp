@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "refclock.h"
+
+// Reads back what ShmRefclock and SockRefclock send, the way
+// ntpd and chrony do, from stand-ins for them.
+
+namespace
+{
+
+// Well clear of the units ntpd and gpsd use.
+const int TEST_SHM_UNIT = 77;
+
+RefclockSample testSample()
+{
+    RefclockSample sample = {};
+    sample.clockTime.tv_sec = 1690423318;    // 2023.207 02:01:58
+    sample.clockTime.tv_nsec = 0;
+    sample.receiveTime.tv_sec = 1690423318;
+    sample.receiveTime.tv_nsec = 12345678;
+    sample.leap = LEAP_INSERT;
+    sample.precision = -13;
+    return sample;
+}
+
+// What chrony's refclock_shm.c does on each poll.
+void checkShm()
+{
+    int id = shmget(ShmRefclock::SHM_KEY_BASE + TEST_SHM_UNIT, sizeof(ShmRefclock::ShmTime), IPC_CREAT | 0600);
+    if (!CHECK(id != -1))
+    {
+        perror("shmget");
+        return;
+    }
+
+    {
+        ShmRefclock refclock(TEST_SHM_UNIT);
+        CHECK(refclock.is_open());
+
+        auto* shm = (ShmRefclock::ShmTime*)shmat(id, nullptr, SHM_RDONLY);
+        if (CHECK(shm != (void*)-1))
+        {
+            CHECK(shm->mode == 1);
+            CHECK(shm->valid == 0);
+
+            RefclockSample sample = testSample();
+            refclock.send(sample);
+            CHECK(refclock.samples_sent() == 1);
+
+            int count = shm->count;
+            ShmRefclock::ShmTime copy = *shm;
+            CHECK(count == shm->count);
+            CHECK(count % 2 == 0);
+            CHECK(copy.valid == 1);
+            CHECK(copy.clockTimeStampSec == sample.clockTime.tv_sec);
+            CHECK(copy.clockTimeStampNSec == 0);
+            CHECK(copy.receiveTimeStampSec == sample.receiveTime.tv_sec);
+            CHECK(copy.receiveTimeStampUSec == 12345);
+            CHECK(copy.receiveTimeStampNSec == 12345678);
+            CHECK(copy.leap == LEAP_INSERT);
+            CHECK(copy.precision == -13);
+
+            shmdt(shm);
+        }
+    }
+
+    shmctl(id, IPC_RMID, nullptr);
+}
+
+int bindSocket(const std::string& path)
+{
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) == -1)
+    {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool receive(int fd, SockRefclock::SockSample& sockSample)
+{
+    return recv(fd, &sockSample, sizeof(sockSample), MSG_DONTWAIT) == sizeof(sockSample);
+}
+
+// What chrony's refclock_sock.c expects, including a chrony
+// that isn't there yet and one that restarts.
+void checkSock()
+{
+    std::string path = "refclock_test." + std::to_string(getpid()) + ".sock";
+    RefclockSample sample = testSample();
+
+    SockRefclock refclock(path);
+    refclock.send(sample);
+    CHECK(refclock.samples_sent() == 0);
+    CHECK(refclock.samples_dropped() == 1);
+
+    int fd = bindSocket(path);
+    if (!CHECK(fd != -1)) return;
+
+    SockRefclock::SockSample sockSample = {};
+    refclock.send(sample);
+    CHECK(refclock.samples_sent() == 1);
+    if (CHECK(receive(fd, sockSample)))
+    {
+        CHECK(sockSample.magic == SockRefclock::SOCK_MAGIC);
+        CHECK(sockSample.tv.tv_sec == sample.receiveTime.tv_sec);
+        CHECK(sockSample.tv.tv_usec == 12345);
+        CHECK_NEAR(sockSample.offset, -0.012345, 1e-9);
+        CHECK(sockSample.pulse == 0);
+        CHECK(sockSample.leap == LEAP_INSERT);
+    }
+
+    close(fd);
+    fd = bindSocket(path);
+    if (CHECK(fd != -1))
+    {
+        refclock.send(sample);
+        CHECK(refclock.samples_sent() == 2);
+        CHECK(receive(fd, sockSample));
+        close(fd);
+    }
+    unlink(path.c_str());
+}
+
+}
+
+int main()
+{
+    checkShm();
+    checkSock();
+    return checkResult();
+}